@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include <functional>
+#include "perf_counters.hpp"
+#include "alloc_tracker.hpp"
+
+
+/*
+	Minimal timing harness: every case is run a few times to warm caches and branch predictors,
+	then timed over several repetitions. A repetition processes a fixed number of items so that
+	fast operations are measured in batches, results are reported per item.
+	Hardware counters of the calling thread are summed over the timed repetitions when available,
+	work done by Swarm workers is not included. Builds with AUTODRONE_ALLOC_TRACKING also report
+	heap allocations per item, over all threads.
+*/
+struct Benchmark
+{
+	struct Result
+	{
+		std::string name;
+		uint64_t items;
+		uint32_t repetitions;
+		double median_ns;
+		double p95_ns;
+		double min_ns;
+		perf::Values counters;
+		uint64_t allocations;
+	};
+
+	uint32_t warmup = 3;
+	uint32_t repetitions = 20;
+	// Only cases whose name contains it are run
+	std::string filter;
+	std::vector<Result> results;
+
+	// setup runs before each repetition and is not timed, body processes items items
+	void run(const std::string& name, uint64_t items, const std::function<void()>& setup, const std::function<void()>& body)
+	{
+		if (name.find(filter) == std::string::npos) {
+			return;
+		}
+		for (uint32_t i(0); i < warmup; ++i) {
+			setup();
+			body();
+		}
+		const perf::ThreadCounters& counters = perf::ThreadCounters::get();
+		perf::Values counters_sum{};
+		uint64_t allocations = 0;
+		std::vector<double> durations;
+		durations.reserve(repetitions);
+		for (uint32_t i(0); i < repetitions; ++i) {
+			setup();
+			const uint64_t allocations_start = getAllocationsCount();
+			const perf::Values counters_start = counters.read();
+			const auto start = std::chrono::steady_clock::now();
+			body();
+			durations.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+			const perf::Values counters_end = counters.read();
+			allocations += getAllocationsCount() - allocations_start;
+			for (uint32_t c(0); c < perf::CountersCount; ++c) {
+				counters_sum[c] += counters_end[c] - counters_start[c];
+			}
+		}
+		std::sort(durations.begin(), durations.end());
+		results.push_back({ name, items, repetitions, getPercentile(durations, 0.5), getPercentile(durations, 0.95), durations.front(), counters_sum, allocations });
+	}
+
+	void run(const std::string& name, uint64_t items, const std::function<void()>& body)
+	{
+		run(name, items, [] {}, body);
+	}
+
+	static uint64_t getAllocationsCount()
+	{
+		const alloc::Totals totals = alloc::getTotals();
+		uint64_t result = 0;
+		for (const uint64_t count : totals.allocations) {
+			result += count;
+		}
+		return result;
+	}
+
+	// Nearest rank on sorted values
+	static double getPercentile(const std::vector<double>& sorted, double ratio)
+	{
+		const uint64_t rank = uint64_t(ratio * double(sorted.size() - 1) + 0.5);
+		return sorted[std::min<uint64_t>(rank, sorted.size() - 1)];
+	}
+
+	// IPC and events per item, null for counters that can't be read
+	static void writeCounters(std::ostream& out, const Result& r)
+	{
+		const perf::ThreadCounters& counters = perf::ThreadCounters::get();
+		const double items = double(r.items) * double(r.repetitions);
+		out << ", \"ipc\": ";
+		if (counters.isAvailable(perf::Cycles) && counters.isAvailable(perf::Instructions) && r.counters[perf::Cycles]) {
+			out << double(r.counters[perf::Instructions]) / double(r.counters[perf::Cycles]);
+		}
+		else {
+			out << "null";
+		}
+		for (const uint32_t c : { perf::Cycles, perf::CacheMisses, perf::BranchMisses }) {
+			out << ", \"" << perf::getName(c) << "_per_item\": ";
+			if (counters.isAvailable(c)) {
+				out << double(r.counters[c]) / items;
+			}
+			else {
+				out << "null";
+			}
+		}
+	}
+
+	void writeJson(std::ostream& out, const std::string& context) const
+	{
+		out << "{\n  \"context\": {" << context << "},\n  \"benchmarks\": [\n";
+		for (uint64_t i(0); i < results.size(); ++i) {
+			const Result& r = results[i];
+			const double ns_per_item = r.median_ns / double(r.items);
+			out << "    {\"name\": \"" << r.name << "\""
+				<< ", \"items\": " << r.items
+				<< ", \"repetitions\": " << r.repetitions
+				<< ", \"median_ns\": " << r.median_ns
+				<< ", \"p95_ns\": " << r.p95_ns
+				<< ", \"min_ns\": " << r.min_ns
+				<< ", \"ns_per_item\": " << ns_per_item
+				<< ", \"items_per_second\": " << 1e9 / ns_per_item;
+			writeCounters(out, r);
+			if (alloc::enabled) {
+				out << ", \"allocations_per_item\": " << double(r.allocations) / (double(r.items) * double(r.repetitions));
+			}
+			out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		out << "  ]\n}" << std::endl;
+	}
+};
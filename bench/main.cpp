@@ -0,0 +1,192 @@
+#include <iostream>
+#include <sstream>
+#include <limits>
+#include "benchmark.hpp"
+#include "stadium.hpp"
+
+
+/*
+	Microbenchmarks of the simulation hot paths, results are written as JSON on stdout
+	so that runs of different commits can be diffed.
+	Usage: autodrone_bench [--filter name] [--repetitions count]
+*/
+
+const float dt = 0.008f;
+const sf::Vector2f area_size(3840.0f, 2160.0f);
+
+
+void benchmarkNetwork(Benchmark& benchmark)
+{
+	const uint64_t calls = 1000;
+	Drone drone;
+	std::vector<float> input(drone.network.input_size, 0.5f);
+
+	Layer& layer = drone.network.layers.front();
+	benchmark.run("Layer::process", calls, [&] {
+		for (uint64_t i(0); i < calls; ++i) {
+			input[i % input.size()] = float(i % 7) * 0.1f;
+			layer.process(input);
+		}
+		doNotOptimize(layer.values[0]);
+	});
+
+	benchmark.run("Network::execute", calls, [&] {
+		float sum = 0.0f;
+		for (uint64_t i(0); i < calls; ++i) {
+			input[i % input.size()] = float(i % 7) * 0.1f;
+			sum += drone.network.execute(input)[0];
+		}
+		doNotOptimize(sum);
+	});
+}
+
+void benchmarkDrone(Benchmark& benchmark)
+{
+	const uint64_t steps = 1000;
+	Drone drone(0.5f * area_size);
+	drone.left.setPower(0.5f);
+	drone.right.setPower(0.5f);
+	benchmark.run("Drone::update", steps, [&] {
+		drone.position = 0.5f * area_size;
+		drone.velocity = sf::Vector2f(0.0f, 0.0f);
+		drone.angle = 0.0f;
+		drone.angular_velocity = 0.0f;
+	}, [&] {
+		for (uint64_t i(0); i < steps; ++i) {
+			drone.update(dt, false);
+		}
+		doNotOptimize(drone.position.x);
+	});
+}
+
+void benchmarkStadium(Benchmark& benchmark)
+{
+	{
+		Stadium stadium(800, area_size);
+		const uint64_t drones_count = stadium.getDronesCount();
+		benchmark.run("Stadium::updateDrone", drones_count, [&] {
+			stadium.initializeTargets();
+			stadium.initializeDrones();
+		}, [&] {
+			for (uint64_t i(0); i < drones_count; ++i) {
+				stadium.updateDrone(i, dt, false);
+			}
+		});
+	}
+
+	// Drones are reset before each repetition so that most of them are alive
+	const uint64_t steps = 10;
+	for (const uint32_t population : { 100u, 800u, 3200u }) {
+		Stadium stadium(population, area_size);
+		std::stringstream name;
+		name << "Stadium::update/" << population;
+		benchmark.run(name.str(), population * steps, [&] {
+			stadium.initializeTargets();
+			stadium.initializeDrones();
+			stadium.current_iteration.reset();
+		}, [&] {
+			for (uint64_t i(0); i < steps; ++i) {
+				stadium.update(dt, false);
+			}
+		});
+	}
+}
+
+void benchmarkSelection(Benchmark& benchmark)
+{
+	const uint32_t population = 800;
+	Selector<Drone> selector(population);
+	// No dump should be written
+	selector.dump_frequency = std::numeric_limits<uint32_t>::max();
+	benchmark.run("Selector::nextGeneration", population, [&] {
+		selector.generation = 1;
+		uint32_t i = 0;
+		for (Drone& d : selector.getCurrentPopulation()) {
+			d.fitness = float(++i % 97);
+		}
+	}, [&] {
+		selector.nextGeneration();
+	});
+
+	const uint64_t picks = 10000;
+	std::vector<Drone>& drones = selector.getCurrentPopulation();
+	SelectionWheel wheel(population);
+	for (uint32_t i(0); i < population; ++i) {
+		drones[i].fitness = float(i % 97);
+	}
+	wheel.addFitnessScores(drones);
+	benchmark.run("SelectionWheel::pick", picks, [&] {
+		float sum = 0.0f;
+		for (uint64_t i(0); i < picks; ++i) {
+			sum += wheel.pick(drones).fitness;
+		}
+		doNotOptimize(sum);
+	});
+
+	// Written in place like the selector does
+	const uint64_t children = 1000;
+	const DNA& dna1 = drones[0].dna;
+	const DNA& dna2 = drones[1].dna;
+	DNA child = dna1;
+	benchmark.run("DNAUtils::makeChild", children, [&] {
+		float sum = 0.0f;
+		for (uint64_t i(0); i < children; ++i) {
+			DNAUtils::makeChild(dna1, dna2, 0.1f, child);
+			sum += child.getGene(0);
+		}
+		doNotOptimize(sum);
+	});
+}
+
+void benchmarkSwarm(Benchmark& benchmark)
+{
+	const uint64_t dispatches = 1000;
+	swrm::Swarm swarm(0);
+	benchmark.run("Swarm::execute", dispatches, [&] {
+		for (uint64_t i(0); i < dispatches; ++i) {
+			swarm.execute([](uint32_t, uint32_t) {}).waitExecutionDone();
+		}
+	});
+
+	benchmark.run("Swarm::async", dispatches, [&] {
+		for (uint64_t i(0); i < dispatches; ++i) {
+			swarm.async([] {}).wait();
+		}
+	});
+}
+
+
+int main(int argc, char** argv)
+{
+	NumberGenerator<>::initialize();
+	NumberGenerator<>::getInstance().seed(0);
+
+	Benchmark benchmark;
+	for (int i(1); i + 1 < argc; i += 2) {
+		const std::string arg = argv[i];
+		if (arg == "--filter") {
+			benchmark.filter = argv[i + 1];
+		}
+		else if (arg == "--repetitions") {
+			benchmark.repetitions = std::max(1, std::atoi(argv[i + 1]));
+		}
+	}
+
+	// The simulation logs on std::cout, only the JSON goes to stdout
+	std::ostream out(std::cout.rdbuf());
+	std::cout.rdbuf(nullptr);
+
+	benchmarkNetwork(benchmark);
+	benchmarkDrone(benchmark);
+	benchmarkStadium(benchmark);
+	benchmarkSelection(benchmark);
+	benchmarkSwarm(benchmark);
+
+	std::stringstream context;
+	const perf::ThreadCounters& counters = perf::ThreadCounters::get();
+	context << "\"topology\": \"" << swrm::Topology::get().describe() << "\", \"threads\": " << swrm::Topology::get().getDefaultThreadCount()
+		<< ", \"perf_counters\": \"" << (counters.isAvailable() ? "available" : "unavailable: " + counters.getError()) << "\"";
+	benchmark.writeJson(out, context.str());
+	std::cout.rdbuf(out.rdbuf());
+	return 0;
+}
@@ -2,46 +2,107 @@
 
 #include "unit.hpp"
 #include "neural_network.hpp"
+#include "sparse_network.hpp"
+#include "quantized_network.hpp"
+#include "profiler.hpp"
 
 
 struct AiUnit : public Unit
 {
 	AiUnit()
 		: Unit(0)
+		, sparse_threshold(0.0f)
+		, quantized(false)
 	{}
 
 	AiUnit(const std::vector<uint64_t>& network_architecture)
-		: Unit(Network::getParametersCount(network_architecture) * 32)
+		: Unit(Network::getParametersCount(network_architecture) * DNA::getGeneBytes() * 8)
 		, network(network_architecture)
+		, sparse_threshold(0.0f)
+		, quantized(false)
 	{
-		dna.initialize<float>(1.0f);
+		dna.initializeGenes(1.0f);
 		updateNetwork();
 	}
 
 	void execute(const std::vector<float>& inputs)
 	{
+		if (quantized) {
+			process(quantized_network.execute(inputs));
+			return;
+		}
+		if (sparse_threshold > 0.0f) {
+			process(sparse_network.execute(inputs));
+			return;
+		}
 		const std::vector<float>& outputs = network.execute(inputs);
 		process(outputs);
 	}
 
 	void updateNetwork()
 	{
+		PROFILE_SCOPE(NetworkBinding);
+		// Genes are decoded straight into the layers
 		uint64_t index = 0;
 		for (Layer& layer : network.layers) {
 			const uint64_t neurons_count = layer.getNeuronsCount();
+			dna.getGenes(index, neurons_count, layer.bias.data());
+			index += neurons_count;
+
+			const uint64_t weights_count = layer.getWeightsCount();
 			for (uint64_t i(0); i < neurons_count; ++i) {
-				layer.bias[i] = dna.get<float>(index++);
+				dna.getGenes(index, weights_count, layer.weights[i].data());
+				index += weights_count;
 			}
+		}
 
-			for (uint64_t i(0); i < neurons_count; ++i) {
-				const uint64_t weights_count = layer.getWeightsCount();
-				for (uint64_t j(0); j < weights_count; ++j) {
-					layer.weights[i][j] = dna.get<float>(index++);
+		if (sparse_threshold > 0.0f) {
+			sparse_network = SparseNetwork(network, sparse_threshold);
+		}
+		if (quantized) {
+			quantized_network = QuantizedNetwork(network);
+		}
+	}
+
+	// Inverse of updateNetwork, writes the current weights in the genome
+	void storeNetwork()
+	{
+		uint64_t index = 0;
+		for (const Layer& layer : network.layers) {
+			for (const float b : layer.bias) {
+				dna.setGene(index++, b);
+			}
+			for (const std::vector<float>& row : layer.weights) {
+				for (const float w : row) {
+					dna.setGene(index++, w);
 				}
 			}
 		}
 	}
 
+	// Replaces the network and starts from a random genome of the matching length
+	void setArchitecture(const std::vector<uint64_t>& network_architecture)
+	{
+		network = Network(network_architecture);
+		dna = DNA(Network::getParametersCount(network_architecture) * DNA::getGeneBytes() * 8);
+		dna.initializeGenes(1.0f);
+		updateNetwork();
+	}
+
+	// Executes a magnitude pruned copy of the network, 0 to use the dense one
+	void setSparseThreshold(float threshold)
+	{
+		sparse_threshold = threshold;
+		updateNetwork();
+	}
+
+	// Executes an int8 copy of the network
+	void setQuantized(bool enabled)
+	{
+		quantized = enabled;
+		updateNetwork();
+	}
+
 	void onUpdateDNA() override
 	{
 		updateNetwork();
@@ -50,4 +111,8 @@ struct AiUnit : public Unit
 	virtual void process(const std::vector<float>& outputs) = 0;
 
 	Network network;
+	float sparse_threshold;
+	SparseNetwork sparse_network;
+	bool quantized;
+	QuantizedNetwork quantized_network;
 };
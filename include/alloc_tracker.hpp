@@ -0,0 +1,288 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <unistd.h>
+#endif
+
+
+/*
+	Heap allocations per thread and per simulation phase. Builds with AUTODRONE_ALLOC_TRACKING
+	replace the global operator new and delete (src/alloc_tracking.cpp), the ALLOC_ macros expand
+	to nothing otherwise. Regions marked allocation free count their allocations as violations,
+	or abort on the first one when enforcement is on.
+	Nothing called from operator new may allocate: slots are a fixed array and the state is zero
+	initialized before main.
+*/
+namespace alloc
+{
+
+enum class Phase : uint32_t
+{
+	Other,
+	// Units are simulation steps
+	Step,
+	// Units are generations
+	Selection,
+	// Units are frames
+	Rendering,
+	Count
+};
+
+constexpr uint32_t phases_count = uint32_t(Phase::Count);
+
+#if defined(AUTODRONE_ALLOC_TRACKING)
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+inline const char* getName(uint32_t phase)
+{
+	static const char* names[phases_count] = { "other", "step", "selection", "rendering" };
+	return names[phase];
+}
+
+inline const char* getUnitName(uint32_t phase)
+{
+	static const char* names[phases_count] = { "", "step", "generation", "frame" };
+	return names[phase];
+}
+
+struct ThreadSlot
+{
+	std::array<std::atomic<uint64_t>, phases_count> allocations;
+	std::array<std::atomic<uint64_t>, phases_count> bytes;
+	std::atomic<uint64_t> frees;
+	std::atomic<uint64_t> violations;
+};
+
+// Threads past the last slot share it
+constexpr uint32_t max_threads = 256;
+
+struct State
+{
+	std::array<ThreadSlot, max_threads> slots;
+	std::atomic<uint32_t> slots_count;
+	std::array<std::atomic<uint64_t>, phases_count> units;
+	std::atomic<bool> enforced;
+};
+
+inline State state;
+
+inline thread_local ThreadSlot* t_slot = nullptr;
+inline thread_local Phase t_phase = Phase::Other;
+inline thread_local uint32_t t_forbidden = 0;
+inline thread_local uint32_t t_permitted = 0;
+
+inline ThreadSlot& getSlot()
+{
+	if (!t_slot) {
+		const uint32_t index = state.slots_count.fetch_add(1, std::memory_order_relaxed);
+		t_slot = &state.slots[std::min(index, max_threads - 1)];
+	}
+	return *t_slot;
+}
+
+// Only writes and aborts, the heap can't be used anymore
+[[noreturn]] inline void abortOnViolation(uint64_t size)
+{
+	char message[128] = "Allocation of ";
+	char digits[24];
+	uint32_t count = 0;
+	do {
+		digits[count++] = char('0' + size % 10);
+		size /= 10;
+	} while (size);
+	uint64_t length = strlen(message);
+	while (count) {
+		message[length++] = digits[--count];
+	}
+	message[length] = '\0';
+	strcat(message, " bytes in an allocation free region, phase ");
+	strcat(message, getName(uint32_t(t_phase)));
+	strcat(message, "\n");
+#if defined(__unix__) || defined(__APPLE__)
+	const ssize_t written = ::write(2, message, strlen(message));
+	(void)written;
+#endif
+	std::abort();
+}
+
+// Called by the replaced operator new
+inline void onAllocation(uint64_t size)
+{
+	ThreadSlot& slot = getSlot();
+	const uint32_t phase = uint32_t(t_phase);
+	slot.allocations[phase].fetch_add(1, std::memory_order_relaxed);
+	slot.bytes[phase].fetch_add(size, std::memory_order_relaxed);
+	if (t_forbidden && !t_permitted) {
+		slot.violations.fetch_add(1, std::memory_order_relaxed);
+		if (state.enforced.load(std::memory_order_relaxed)) {
+			abortOnViolation(size);
+		}
+	}
+}
+
+inline void onFree()
+{
+	getSlot().frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Aborts on allocations in allocation free regions instead of counting them
+inline void setEnforced(bool enforced)
+{
+	state.enforced.store(enforced, std::memory_order_relaxed);
+}
+
+inline void addUnit(Phase phase)
+{
+	state.units[uint32_t(phase)].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Allocations of the calling thread are attributed to phase during its lifetime
+class PhaseScope
+{
+public:
+	PhaseScope(Phase phase)
+		: m_previous(t_phase)
+	{
+		t_phase = phase;
+	}
+
+	~PhaseScope()
+	{
+		t_phase = m_previous;
+	}
+
+private:
+	Phase m_previous;
+};
+
+// No allocation is expected from the calling thread during its lifetime
+class FreeScope
+{
+public:
+	FreeScope()
+	{
+		++t_forbidden;
+	}
+
+	~FreeScope()
+	{
+		--t_forbidden;
+	}
+};
+
+// One-off allocations (first use of per thread buffers) are allowed inside allocation free regions
+class PermitScope
+{
+public:
+	PermitScope()
+	{
+		++t_permitted;
+	}
+
+	~PermitScope()
+	{
+		--t_permitted;
+	}
+};
+
+struct Totals
+{
+	std::array<uint64_t, phases_count> allocations{};
+	std::array<uint64_t, phases_count> bytes{};
+	std::array<uint64_t, phases_count> units{};
+	uint64_t frees = 0;
+	uint64_t violations = 0;
+
+	void add(const ThreadSlot& slot)
+	{
+		for (uint32_t p(0); p < phases_count; ++p) {
+			allocations[p] += slot.allocations[p].load(std::memory_order_relaxed);
+			bytes[p] += slot.bytes[p].load(std::memory_order_relaxed);
+		}
+		frees += slot.frees.load(std::memory_order_relaxed);
+		violations += slot.violations.load(std::memory_order_relaxed);
+	}
+};
+
+inline uint32_t getThreadsCount()
+{
+	return std::min(state.slots_count.load(std::memory_order_relaxed), max_threads);
+}
+
+inline Totals getTotals()
+{
+	Totals result;
+	for (uint32_t i(0); i < getThreadsCount(); ++i) {
+		result.add(state.slots[i]);
+	}
+	for (uint32_t p(0); p < phases_count; ++p) {
+		result.units[p] = state.units[p].load(std::memory_order_relaxed);
+	}
+	return result;
+}
+
+// Allocations per step and in selection between two snapshots, one line per generation
+inline void printGeneration(uint32_t generation, const Totals& last, const Totals& current)
+{
+	const uint32_t step = uint32_t(Phase::Step);
+	const uint32_t selection = uint32_t(Phase::Selection);
+	const uint64_t steps = current.units[step] - last.units[step];
+	std::cout << "Allocations gen " << generation << ": "
+		<< double(current.allocations[step] - last.allocations[step]) / double(std::max<uint64_t>(1, steps)) << " per step (" << steps << " steps), "
+		<< current.allocations[selection] - last.allocations[selection] << " in selection, "
+		<< current.violations - last.violations << " in allocation free regions" << std::endl;
+}
+
+// Per phase over all threads, then each thread
+inline void report()
+{
+	if (!enabled) {
+		std::cout << "Allocation tracking: built without AUTODRONE_ALLOC_TRACKING" << std::endl;
+		return;
+	}
+	const Totals totals = getTotals();
+	std::cout << "Allocations, " << totals.frees << " frees, " << totals.violations << " in allocation free regions" << std::endl;
+	for (uint32_t p(0); p < phases_count; ++p) {
+		std::cout << "  " << getName(p) << ": " << totals.allocations[p] << " (" << totals.bytes[p] << " bytes)";
+		if (totals.units[p]) {
+			std::cout << ", " << double(totals.allocations[p]) / double(totals.units[p]) << " per " << getUnitName(p) << " over " << totals.units[p];
+		}
+		std::cout << std::endl;
+	}
+	for (uint32_t i(0); i < getThreadsCount(); ++i) {
+		Totals thread;
+		thread.add(state.slots[i]);
+		std::cout << "  thread " << i << ":";
+		for (uint32_t p(0); p < phases_count; ++p) {
+			std::cout << " " << getName(p) << " " << thread.allocations[p];
+		}
+		std::cout << std::endl;
+	}
+}
+
+}
+
+#define ALLOC_CONCAT_INNER(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_INNER(a, b)
+
+#if defined(AUTODRONE_ALLOC_TRACKING)
+	#define ALLOC_PHASE(phase) const alloc::PhaseScope ALLOC_CONCAT(alloc_phase_, __LINE__)(alloc::Phase::phase)
+	#define ALLOC_FREE_REGION() const alloc::FreeScope ALLOC_CONCAT(alloc_free_, __LINE__)
+	#define ALLOC_PERMIT() const alloc::PermitScope ALLOC_CONCAT(alloc_permit_, __LINE__)
+	#define ALLOC_UNIT(phase) alloc::addUnit(alloc::Phase::phase)
+#else
+	#define ALLOC_PHASE(phase)
+	#define ALLOC_FREE_REGION()
+	#define ALLOC_PERMIT()
+	#define ALLOC_UNIT(phase)
+#endif
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include "stadium.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <unistd.h>
+#endif
+
+
+/*
+	Picks the thread count and update grain giving the fastest simulation step for a population size.
+	Each candidate flies a fresh population for a few hundred steps, the time per drone step is kept.
+	Results are cached per host, population and topology in a small text file, one setting per line.
+*/
+struct Autotuner
+{
+	struct Setting
+	{
+		uint32_t threads = 0;
+		uint64_t grain = 16;
+		// Nanoseconds per alive drone update
+		double step_ns = 0.0;
+	};
+
+	static constexpr const char* cache_file = "../autotune.cfg";
+	// Drones are reset every rollout_steps so that most of them are alive while measuring
+	uint32_t rollout_steps = 100;
+	uint32_t rollouts = 3;
+
+	static std::string getHostKey(uint32_t population)
+	{
+		char hostname[256] = "unknown";
+#if defined(__unix__) || defined(__APPLE__)
+		gethostname(hostname, sizeof(hostname) - 1);
+#endif
+		std::stringstream sstr;
+		sstr << hostname << "/" << population << "/" << swrm::Topology::get().cpus.size() << "cpus";
+		return sstr.str();
+	}
+
+	static bool load(uint32_t population, Setting& setting)
+	{
+		std::ifstream file(cache_file);
+		const std::string key = getHostKey(population);
+		std::string line;
+		bool found = false;
+		// The last entry for a key wins, retuning just appends
+		while (std::getline(file, line)) {
+			std::stringstream sstr(line);
+			std::string line_key;
+			Setting candidate;
+			if (sstr >> line_key >> candidate.threads >> candidate.grain >> candidate.step_ns && line_key == key) {
+				setting = candidate;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	static void save(uint32_t population, const Setting& setting)
+	{
+		std::ofstream file(cache_file, std::ios::app);
+		file << getHostKey(population) << " " << setting.threads << " " << setting.grain << " " << setting.step_ns << std::endl;
+	}
+
+	std::vector<uint32_t> getThreadCandidates() const
+	{
+		const swrm::Topology& topology = swrm::Topology::get();
+		std::vector<uint32_t> result;
+		for (uint32_t threads(1); threads < topology.getCoresCount(); threads *= 2) {
+			result.push_back(threads);
+		}
+		result.push_back(topology.getCoresCount());
+		result.push_back(uint32_t(topology.cpus.size()));
+		std::sort(result.begin(), result.end());
+		result.erase(std::unique(result.begin(), result.end()), result.end());
+		return result;
+	}
+
+	Setting tune(uint32_t population, sf::Vector2f area_size, float dt) const
+	{
+		const std::vector<uint64_t> grains = { 4, 8, 16, 32, 64, 128 };
+		Setting best;
+		best.step_ns = std::numeric_limits<double>::max();
+		std::cout << "Tuning the simulation step for " << population << " drones" << std::endl;
+		for (const uint32_t threads : getThreadCandidates()) {
+			Stadium stadium(population, area_size, threads);
+			for (const uint64_t grain : grains) {
+				stadium.update_grain = grain;
+				const double step_ns = measure(stadium, dt);
+				std::cout << "  threads " << threads << " grain " << grain << ": " << step_ns << " ns per drone step" << std::endl;
+				if (step_ns < best.step_ns) {
+					best = { threads, grain, step_ns };
+				}
+			}
+		}
+		std::cout << "Selected " << best.threads << " threads, grain " << best.grain << std::endl;
+		return best;
+	}
+
+	// Best of the rollouts, the others are disturbed by something else
+	double measure(Stadium& stadium, float dt) const
+	{
+		double result = std::numeric_limits<double>::max();
+		for (uint32_t r(0); r < rollouts; ++r) {
+			stadium.initializeTargets();
+			stadium.initializeDrones();
+			stadium.current_iteration.reset();
+			const auto start = std::chrono::steady_clock::now();
+			for (uint32_t s(0); s < rollout_steps && stadium.getAliveCount(); ++s) {
+				stadium.update(dt, false);
+			}
+			const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			result = std::min(result, elapsed / double(std::max<uint64_t>(1, stadium.current_iteration.drone_steps)));
+		}
+		return result;
+	}
+
+	// Tunes when asked to, otherwise uses the cached setting if there is one
+	static bool getSetting(uint32_t population, sf::Vector2f area_size, float dt, bool retune, Setting& setting)
+	{
+		if (!retune) {
+			if (load(population, setting)) {
+				std::cout << "Tuned setting: " << setting.threads << " threads, grain " << setting.grain << std::endl;
+				return true;
+			}
+			return false;
+		}
+		setting = Autotuner().tune(population, area_size, dt);
+		save(population, setting);
+		return true;
+	}
+};
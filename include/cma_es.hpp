@@ -0,0 +1,506 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include <future>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include "optimizer.hpp"
+
+
+/*
+	Eigen decomposition of a symmetric matrix, Householder tridiagonalization followed by QL iterations.
+	Row major n x n matrix in, eigenvectors as columns and eigenvalues out.
+*/
+struct SymmetricEigen
+{
+	std::vector<double> vectors;
+	std::vector<double> values;
+
+	void decompose(const std::vector<double>& matrix, uint64_t n)
+	{
+		vectors = matrix;
+		values.assign(n, 0.0);
+		std::vector<double> e(n, 0.0);
+		tridiagonalize(n, e);
+		diagonalize(n, e);
+	}
+
+private:
+	double& v(uint64_t i, uint64_t j, uint64_t n)
+	{
+		return vectors[i * n + j];
+	}
+
+	void tridiagonalize(uint64_t n, std::vector<double>& e)
+	{
+		std::vector<double>& d = values;
+		for (uint64_t j(0); j < n; ++j) {
+			d[j] = v(n - 1, j, n);
+		}
+
+		for (uint64_t i(n - 1); i > 0; --i) {
+			double scale = 0.0;
+			double h = 0.0;
+			for (uint64_t k(0); k < i; ++k) {
+				scale += std::abs(d[k]);
+			}
+
+			if (scale == 0.0) {
+				e[i] = d[i - 1];
+				for (uint64_t j(0); j < i; ++j) {
+					d[j] = v(i - 1, j, n);
+					v(i, j, n) = 0.0;
+					v(j, i, n) = 0.0;
+				}
+			}
+			else {
+				for (uint64_t k(0); k < i; ++k) {
+					d[k] /= scale;
+					h += d[k] * d[k];
+				}
+				double f = d[i - 1];
+				double g = std::sqrt(h);
+				if (f > 0.0) {
+					g = -g;
+				}
+				e[i] = scale * g;
+				h -= f * g;
+				d[i - 1] = f - g;
+				for (uint64_t j(0); j < i; ++j) {
+					e[j] = 0.0;
+				}
+
+				for (uint64_t j(0); j < i; ++j) {
+					f = d[j];
+					v(j, i, n) = f;
+					g = e[j] + v(j, j, n) * f;
+					for (uint64_t k(j + 1); k < i; ++k) {
+						g += v(k, j, n) * d[k];
+						e[k] += v(k, j, n) * f;
+					}
+					e[j] = g;
+				}
+
+				f = 0.0;
+				for (uint64_t j(0); j < i; ++j) {
+					e[j] /= h;
+					f += e[j] * d[j];
+				}
+				const double hh = f / (h + h);
+				for (uint64_t j(0); j < i; ++j) {
+					e[j] -= hh * d[j];
+				}
+				for (uint64_t j(0); j < i; ++j) {
+					f = d[j];
+					g = e[j];
+					for (uint64_t k(j); k < i; ++k) {
+						v(k, j, n) -= (f * e[k] + g * d[k]);
+					}
+					d[j] = v(i - 1, j, n);
+					v(i, j, n) = 0.0;
+				}
+			}
+			d[i] = h;
+		}
+
+		// Accumulate transformations
+		for (uint64_t i(0); i < n - 1; ++i) {
+			v(n - 1, i, n) = v(i, i, n);
+			v(i, i, n) = 1.0;
+			const double h = d[i + 1];
+			if (h != 0.0) {
+				for (uint64_t k(0); k <= i; ++k) {
+					d[k] = v(k, i + 1, n) / h;
+				}
+				for (uint64_t j(0); j <= i; ++j) {
+					double g = 0.0;
+					for (uint64_t k(0); k <= i; ++k) {
+						g += v(k, i + 1, n) * v(k, j, n);
+					}
+					for (uint64_t k(0); k <= i; ++k) {
+						v(k, j, n) -= g * d[k];
+					}
+				}
+			}
+			for (uint64_t k(0); k <= i; ++k) {
+				v(k, i + 1, n) = 0.0;
+			}
+		}
+		for (uint64_t j(0); j < n; ++j) {
+			d[j] = v(n - 1, j, n);
+			v(n - 1, j, n) = 0.0;
+		}
+		v(n - 1, n - 1, n) = 1.0;
+		e[0] = 0.0;
+	}
+
+	void diagonalize(uint64_t n, std::vector<double>& e)
+	{
+		std::vector<double>& d = values;
+		for (uint64_t i(1); i < n; ++i) {
+			e[i - 1] = e[i];
+		}
+		e[n - 1] = 0.0;
+
+		double f = 0.0;
+		double tst1 = 0.0;
+		const double eps = std::pow(2.0, -52.0);
+		for (uint64_t l(0); l < n; ++l) {
+			tst1 = std::max(tst1, std::abs(d[l]) + std::abs(e[l]));
+			uint64_t m = l;
+			while (m < n - 1 && std::abs(e[m]) > eps * tst1) {
+				++m;
+			}
+
+			if (m > l) {
+				do {
+					double g = d[l];
+					double p = (d[l + 1] - g) / (2.0 * e[l]);
+					double r = std::hypot(p, 1.0);
+					if (p < 0.0) {
+						r = -r;
+					}
+					d[l] = e[l] / (p + r);
+					d[l + 1] = e[l] * (p + r);
+					const double dl1 = d[l + 1];
+					double h = g - d[l];
+					for (uint64_t i(l + 2); i < n; ++i) {
+						d[i] -= h;
+					}
+					f += h;
+
+					p = d[m];
+					double c = 1.0;
+					double c2 = c;
+					double c3 = c;
+					const double el1 = e[l + 1];
+					double s = 0.0;
+					double s2 = 0.0;
+					for (int64_t i(int64_t(m) - 1); i >= int64_t(l); --i) {
+						c3 = c2;
+						c2 = c;
+						s2 = s;
+						g = c * e[i];
+						h = c * p;
+						r = std::hypot(p, e[i]);
+						e[i + 1] = s * r;
+						s = e[i] / r;
+						c = p / r;
+						p = c * d[i] - s * g;
+						d[i + 1] = h + s * (c * g + s * d[i]);
+						for (uint64_t k(0); k < n; ++k) {
+							h = v(k, i + 1, n);
+							v(k, i + 1, n) = s * v(k, i, n) + c * h;
+							v(k, i, n) = c * v(k, i, n) - s * h;
+						}
+					}
+					p = -s * s2 * c3 * el1 * e[l] / dl1;
+					e[l] = s * p;
+					d[l] = c * p;
+				} while (std::abs(e[l]) > eps * tst1);
+			}
+			d[l] += f;
+			e[l] = 0.0;
+		}
+	}
+};
+
+
+/*
+	Covariance Matrix Adaptation Evolution Strategy, maximizes fitness.
+	The full covariance is decomposed in the background while the next population is evaluated,
+	sampling uses the last available decomposition. The separable variant only adapts the diagonal
+	and is used by default for large genomes.
+*/
+struct CmaEsOptimizer : public Optimizer
+{
+	const uint64_t n;
+	const uint64_t lambda;
+	const uint64_t mu;
+	bool separable;
+	bool asynchronous_decomposition = true;
+
+	std::vector<double> weights;
+	double mu_eff;
+	double c_sigma;
+	double d_sigma;
+	double c_c;
+	double c_1;
+	double c_mu;
+	double chi_n;
+
+	std::vector<double> mean;
+	double sigma;
+	std::vector<double> p_sigma;
+	std::vector<double> p_c;
+	// Full covariance (n x n) or its diagonal when separable
+	std::vector<double> covariance;
+	// C = B.D^2.B^T, B is unused when separable
+	std::vector<double> basis;
+	std::vector<double> scales;
+	std::future<SymmetricEigen> pending_decomposition;
+
+	// Samples of the last ask: z ~ N(0, I) and y = B.D.z, lambda x n
+	std::vector<double> z;
+	std::vector<double> y;
+	uint64_t generation;
+	std::mt19937 generator;
+	std::normal_distribution<double> normal;
+
+	CmaEsOptimizer(uint64_t dimension, uint64_t population_size, double initial_sigma = 0.5, uint32_t seed = 0, int32_t separable_mode = -1)
+		: n(dimension)
+		, lambda(population_size)
+		, mu(population_size / 2)
+		, separable(separable_mode < 0 ? dimension > 500 : separable_mode > 0)
+		, mean(dimension, 0.0)
+		, sigma(initial_sigma)
+		, p_sigma(dimension, 0.0)
+		, p_c(dimension, 0.0)
+		, scales(dimension, 1.0)
+		, z(population_size * dimension)
+		, y(population_size * dimension)
+		, generation(0)
+		, generator(seed)
+	{
+		initializeParameters();
+		if (separable) {
+			covariance.assign(n, 1.0);
+		}
+		else {
+			covariance.assign(n * n, 0.0);
+			basis.assign(n * n, 0.0);
+			for (uint64_t i(0); i < n; ++i) {
+				covariance[i * n + i] = 1.0;
+				basis[i * n + i] = 1.0;
+			}
+		}
+	}
+
+	~CmaEsOptimizer()
+	{
+		if (pending_decomposition.valid()) {
+			pending_decomposition.wait();
+		}
+	}
+
+	void ask(std::vector<DNA>& genomes) override
+	{
+		const uint64_t count = std::min<uint64_t>(lambda, genomes.size());
+		std::vector<double> scaled(n);
+		for (uint64_t k(0); k < count; ++k) {
+			double* zk = &z[k * n];
+			double* yk = &y[k * n];
+			for (uint64_t i(0); i < n; ++i) {
+				zk[i] = normal(generator);
+				scaled[i] = scales[i] * zk[i];
+			}
+
+			if (separable) {
+				std::copy(scaled.begin(), scaled.end(), yk);
+			}
+			else {
+				for (uint64_t r(0); r < n; ++r) {
+					const double* row = &basis[r * n];
+					double acc = 0.0;
+					for (uint64_t c(0); c < n; ++c) {
+						acc += row[c] * scaled[c];
+					}
+					yk[r] = acc;
+				}
+			}
+
+			for (uint64_t i(0); i < n; ++i) {
+				genomes[k].setGene(i, float(mean[i] + sigma * yk[i]));
+			}
+		}
+	}
+
+	void tell(const std::vector<float>& fitness) override
+	{
+		const uint64_t count = std::min<uint64_t>(lambda, fitness.size());
+		std::vector<uint64_t> ranking(count);
+		std::iota(ranking.begin(), ranking.end(), 0);
+		std::sort(ranking.begin(), ranking.end(), [&](uint64_t a, uint64_t b) { return fitness[a] > fitness[b]; });
+
+		// Weighted mean of the best steps
+		std::vector<double> y_w(n, 0.0);
+		for (uint64_t i(0); i < mu; ++i) {
+			const double* yk = &y[ranking[i] * n];
+			for (uint64_t j(0); j < n; ++j) {
+				y_w[j] += weights[i] * yk[j];
+			}
+		}
+		for (uint64_t j(0); j < n; ++j) {
+			mean[j] += sigma * y_w[j];
+		}
+
+		// Step size path uses C^-1/2.y_w
+		const std::vector<double> whitened = getInverseSqrtProduct(y_w);
+		const double cs_factor = std::sqrt(c_sigma * (2.0 - c_sigma) * mu_eff);
+		double p_sigma_norm = 0.0;
+		for (uint64_t j(0); j < n; ++j) {
+			p_sigma[j] = (1.0 - c_sigma) * p_sigma[j] + cs_factor * whitened[j];
+			p_sigma_norm += p_sigma[j] * p_sigma[j];
+		}
+		p_sigma_norm = std::sqrt(p_sigma_norm);
+
+		++generation;
+		const double correction = std::sqrt(1.0 - std::pow(1.0 - c_sigma, 2.0 * generation));
+		const bool h_sigma = p_sigma_norm / correction < (1.4 + 2.0 / (n + 1.0)) * chi_n;
+		const double cc_factor = std::sqrt(c_c * (2.0 - c_c) * mu_eff);
+		for (uint64_t j(0); j < n; ++j) {
+			p_c[j] = (1.0 - c_c) * p_c[j] + h_sigma * cc_factor * y_w[j];
+		}
+
+		updateCovariance(ranking, h_sigma);
+		sigma *= std::exp((c_sigma / d_sigma) * (p_sigma_norm / chi_n - 1.0));
+
+		// Whitening above had to use the decomposition the samples were drawn with
+		installDecomposition();
+		scheduleDecomposition();
+	}
+
+private:
+	void initializeParameters()
+	{
+		weights.resize(mu);
+		double sum = 0.0;
+		for (uint64_t i(0); i < mu; ++i) {
+			weights[i] = std::log(mu + 0.5) - std::log(i + 1.0);
+			sum += weights[i];
+		}
+		double sum_sq = 0.0;
+		for (double& w : weights) {
+			w /= sum;
+			sum_sq += w * w;
+		}
+		mu_eff = 1.0 / sum_sq;
+
+		const double dim = double(n);
+		c_sigma = (mu_eff + 2.0) / (dim + mu_eff + 5.0);
+		d_sigma = 1.0 + 2.0 * std::max(0.0, std::sqrt((mu_eff - 1.0) / (dim + 1.0)) - 1.0) + c_sigma;
+		c_c = (4.0 + mu_eff / dim) / (dim + 4.0 + 2.0 * mu_eff / dim);
+		c_1 = 2.0 / ((dim + 1.3) * (dim + 1.3) + mu_eff);
+		c_mu = std::min(1.0 - c_1, 2.0 * (mu_eff - 2.0 + 1.0 / mu_eff) / ((dim + 2.0) * (dim + 2.0) + mu_eff));
+		if (separable) {
+			// Diagonal only learning can go faster
+			const double factor = (dim + 2.0) / 3.0;
+			c_1 = std::min(1.0, c_1 * factor);
+			c_mu = std::min(1.0 - c_1, c_mu * factor);
+		}
+		chi_n = std::sqrt(dim) * (1.0 - 1.0 / (4.0 * dim) + 1.0 / (21.0 * dim * dim));
+	}
+
+	std::vector<double> getInverseSqrtProduct(const std::vector<double>& v) const
+	{
+		std::vector<double> result(n, 0.0);
+		if (separable) {
+			for (uint64_t j(0); j < n; ++j) {
+				result[j] = v[j] / scales[j];
+			}
+			return result;
+		}
+
+		// B.D^-1.B^T.v
+		std::vector<double> projected(n, 0.0);
+		for (uint64_t r(0); r < n; ++r) {
+			const double* row = &basis[r * n];
+			for (uint64_t c(0); c < n; ++c) {
+				projected[c] += row[c] * v[r];
+			}
+		}
+		for (uint64_t c(0); c < n; ++c) {
+			projected[c] /= scales[c];
+		}
+		for (uint64_t r(0); r < n; ++r) {
+			const double* row = &basis[r * n];
+			double acc = 0.0;
+			for (uint64_t c(0); c < n; ++c) {
+				acc += row[c] * projected[c];
+			}
+			result[r] = acc;
+		}
+		return result;
+	}
+
+	void updateCovariance(const std::vector<uint64_t>& ranking, bool h_sigma)
+	{
+		const double decay = 1.0 - c_1 - c_mu + (1.0 - h_sigma) * c_1 * c_c * (2.0 - c_c);
+		if (separable) {
+			for (uint64_t j(0); j < n; ++j) {
+				double rank_mu = 0.0;
+				for (uint64_t i(0); i < mu; ++i) {
+					const double value = y[ranking[i] * n + j];
+					rank_mu += weights[i] * value * value;
+				}
+				covariance[j] = decay * covariance[j] + c_1 * p_c[j] * p_c[j] + c_mu * rank_mu;
+				scales[j] = std::sqrt(std::max(covariance[j], 1e-20));
+			}
+			return;
+		}
+
+		// Only the upper triangle is computed, then mirrored
+		for (uint64_t r(0); r < n; ++r) {
+			double* row = &covariance[r * n];
+			for (uint64_t c(r); c < n; ++c) {
+				row[c] = decay * row[c] + c_1 * p_c[r] * p_c[c];
+			}
+		}
+		for (uint64_t i(0); i < mu; ++i) {
+			const double* yk = &y[ranking[i] * n];
+			const double w = c_mu * weights[i];
+			for (uint64_t r(0); r < n; ++r) {
+				const double wy = w * yk[r];
+				double* row = &covariance[r * n];
+				for (uint64_t c(r); c < n; ++c) {
+					row[c] += wy * yk[c];
+				}
+			}
+		}
+		for (uint64_t r(0); r < n; ++r) {
+			for (uint64_t c(0); c < r; ++c) {
+				covariance[r * n + c] = covariance[c * n + r];
+			}
+		}
+	}
+
+	void scheduleDecomposition()
+	{
+		if (separable) {
+			return;
+		}
+
+		const std::vector<double> snapshot = covariance;
+		const uint64_t dimension = n;
+		auto task = [snapshot, dimension]() {
+			SymmetricEigen eigen;
+			eigen.decompose(snapshot, dimension);
+			return eigen;
+		};
+
+		if (asynchronous_decomposition) {
+			pending_decomposition = std::async(std::launch::async, task);
+		}
+		else {
+			std::promise<SymmetricEigen> promise;
+			promise.set_value(task());
+			pending_decomposition = promise.get_future();
+			installDecomposition();
+		}
+	}
+
+	void installDecomposition()
+	{
+		if (!pending_decomposition.valid()) {
+			return;
+		}
+
+		const SymmetricEigen eigen = pending_decomposition.get();
+		basis = eigen.vectors;
+		for (uint64_t i(0); i < n; ++i) {
+			scales[i] = std::sqrt(std::max(eigen.values[i], 1e-20));
+		}
+	}
+};
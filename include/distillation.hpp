@@ -0,0 +1,144 @@
+#pragma once
+
+#include <numeric>
+#include "stadium.hpp"
+
+
+/*
+	Fits a smaller network to the behaviour of a champion.
+	The teacher flies many scenarios while its (input, output) pairs are recorded, the student
+	is trained on them by mini batch gradient descent and both are then flown on new scenarios.
+	The student is only written if it keeps min_fitness_ratio of the teacher's fitness there.
+*/
+struct Distillation
+{
+	uint32_t scenarios_count = 64;
+	uint32_t epochs = 40;
+	uint32_t batch_size = 32;
+	float learning_rate = 0.05f;
+
+	// Recorded pairs, stored one after another
+	std::vector<float> inputs;
+	std::vector<float> outputs;
+	uint64_t input_size = 0;
+	uint64_t output_size = 0;
+
+	uint64_t getSamplesCount() const
+	{
+		return input_size ? inputs.size() / input_size : 0;
+	}
+
+	// The teacher has to use the dense controller, its inputs are read back from its network
+	void record(const DNA& teacher, const std::vector<uint64_t>& teacher_architecture, sf::Vector2f area_size, float dt, uint32_t seed)
+	{
+		Stadium stadium(1, area_size);
+		prepare(stadium, teacher, teacher_architecture, seed);
+		stadium.syncScenariosDrones();
+		stadium.initializeTargets();
+		stadium.initializeDrones();
+		stadium.current_iteration.reset();
+
+		input_size = teacher_architecture.front();
+		output_size = teacher_architecture.back();
+		const uint64_t drones_count = stadium.getDronesCount();
+		std::vector<bool> was_alive(drones_count);
+		while (stadium.getAliveCount() && stadium.current_iteration.time <= stadium.max_iteration_time) {
+			for (uint64_t i(0); i < drones_count; ++i) {
+				was_alive[i] = stadium.getDrone(i).alive;
+			}
+			stadium.update(dt, false);
+			for (uint64_t i(0); i < drones_count; ++i) {
+				if (was_alive[i]) {
+					const Network& network = stadium.getDrone(i).network;
+					inputs.insert(inputs.end(), network.last_input.begin(), network.last_input.end());
+					outputs.insert(outputs.end(), network.layers.back().values.begin(), network.layers.back().values.end());
+				}
+			}
+		}
+	}
+
+	float train(Network& student, uint32_t seed)
+	{
+		std::mt19937 generator(seed);
+		const uint64_t samples_count = getSamplesCount();
+		std::vector<uint64_t> order(samples_count);
+		std::iota(order.begin(), order.end(), 0);
+
+		float loss = 0.0f;
+		std::vector<float> input(input_size);
+		std::vector<float> gradient(output_size);
+		for (uint32_t epoch(0); epoch < epochs; ++epoch) {
+			std::shuffle(order.begin(), order.end(), generator);
+			loss = 0.0f;
+			uint64_t in_batch = 0;
+			for (const uint64_t i : order) {
+				std::copy(&inputs[i * input_size], &inputs[i * input_size] + input_size, input.begin());
+				const std::vector<float>& output = student.execute(input);
+				const float* target = &outputs[i * output_size];
+				for (uint64_t k(0); k < output_size; ++k) {
+					const float error = output[k] - target[k];
+					loss += error * error;
+					gradient[k] = error;
+				}
+				student.backward(gradient);
+				if (++in_batch == batch_size) {
+					student.descend(learning_rate, in_batch);
+					in_batch = 0;
+				}
+			}
+			student.descend(learning_rate, in_batch);
+			loss /= float(samples_count);
+			if (!(epoch % 10) || epoch + 1 == epochs) {
+				std::cout << "  Epoch " << epoch << " loss " << loss << std::endl;
+			}
+		}
+		return loss;
+	}
+
+	// Mean fitness over scenarios_count target sets drawn from seed
+	float evaluate(const DNA& dna, const std::vector<uint64_t>& network_architecture, sf::Vector2f area_size, float dt, uint32_t seed) const
+	{
+		Stadium stadium(1, area_size);
+		prepare(stadium, dna, network_architecture, seed);
+		stadium.evaluatePopulation(dt);
+		return stadium.selector.getCurrentPopulation()[0].fitness;
+	}
+
+	// A single unit flying all the scenarios at once
+	void prepare(Stadium& stadium, const DNA& dna, const std::vector<uint64_t>& network_architecture, uint32_t seed) const
+	{
+		Drone& drone = stadium.selector.getCurrentPopulation()[0];
+		drone.setArchitecture(network_architecture);
+		drone.loadDNA(dna);
+		stadium.fixed_scenarios = true;
+		stadium.scenarios_seed = seed;
+		stadium.setScenariosCount(scenarios_count);
+	}
+
+	static bool run(const DNA& teacher, const std::vector<uint64_t>& teacher_architecture, const std::vector<uint64_t>& student_architecture, sf::Vector2f area_size, float dt, uint32_t seed, float min_fitness_ratio)
+	{
+		Distillation distillation;
+		distillation.record(teacher, teacher_architecture, area_size, dt, seed);
+		std::cout << "Distillation, " << distillation.getSamplesCount() << " samples recorded" << std::endl;
+
+		Drone student;
+		student.setArchitecture(student_architecture);
+		distillation.train(student.network, seed);
+		student.storeNetwork();
+
+		// Verified on scenarios not seen during recording
+		const uint32_t test_seed = seed + 1000;
+		const float teacher_fitness = distillation.evaluate(teacher, teacher_architecture, area_size, dt, test_seed);
+		const float student_fitness = distillation.evaluate(student.dna, student_architecture, area_size, dt, test_seed);
+		std::cout << "  Parameters " << Network::getParametersCount(teacher_architecture) << " -> " << Network::getParametersCount(student_architecture) << std::endl;
+		std::cout << "  Fitness teacher " << teacher_fitness << ", student " << student_fitness << std::endl;
+		const float ratio = teacher_fitness > 0.0f ? student_fitness / teacher_fitness : 0.0f;
+		if (ratio < min_fitness_ratio) {
+			std::cout << "  STUDENT REJECTED: " << ratio << " of the teacher's fitness, " << min_fitness_ratio << " needed" << std::endl;
+			return false;
+		}
+		DnaLoader::writeDnaToFile("../distilled_student.bin", student.dna);
+		std::cout << "  Student written in ../distilled_student.bin" << std::endl;
+		return true;
+	}
+};
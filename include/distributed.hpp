@@ -0,0 +1,349 @@
+#pragma once
+
+// Coordinator / worker evaluation relies on fork and Unix domain sockets
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cstring>
+#include <list>
+#include "stadium.hpp"
+
+
+/*
+	Messages are a fixed header followed by a raw slab:
+	 - Evaluate: count genomes of element_bytes each, back to back
+	 - Result:   count floats, the fitness of each genome in the same order
+*/
+struct MessageHeader
+{
+	enum Type : uint32_t
+	{
+		Evaluate = 1,
+		Result   = 2,
+		Stop     = 3
+	};
+
+	static constexpr uint32_t MAGIC = 0x44524E45;
+
+	uint32_t magic;
+	uint32_t type;
+	uint32_t generation;
+	uint32_t scenario_seed;
+	uint32_t count;
+	uint32_t element_bytes;
+
+	uint64_t getPayloadSize() const
+	{
+		return uint64_t(count) * element_bytes;
+	}
+};
+
+
+struct Socket
+{
+#if defined(MSG_NOSIGNAL)
+	static constexpr int send_flags = MSG_NOSIGNAL;
+#else
+	// No MSG_NOSIGNAL on macOS, SO_NOSIGPIPE is set on the socket instead
+	static constexpr int send_flags = 0;
+#endif
+
+	// Sending to a worker that died has to fail instead of raising SIGPIPE
+	static void disableSigpipe(int fd)
+	{
+#if defined(SO_NOSIGPIPE)
+		const int on = 1;
+		::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+		(void)fd;
+#endif
+	}
+
+	static bool sendAll(int fd, const void* data, uint64_t size)
+	{
+		const char* ptr = static_cast<const char*>(data);
+		while (size) {
+			const ssize_t sent = ::send(fd, ptr, size, send_flags);
+			if (sent <= 0) {
+				return false;
+			}
+			ptr  += sent;
+			size -= sent;
+		}
+		return true;
+	}
+
+	static bool receiveAll(int fd, void* data, uint64_t size)
+	{
+		char* ptr = static_cast<char*>(data);
+		while (size) {
+			const ssize_t received = ::recv(fd, ptr, size, 0);
+			if (received <= 0) {
+				return false;
+			}
+			ptr  += received;
+			size -= received;
+		}
+		return true;
+	}
+
+	static bool sendMessage(int fd, const MessageHeader& header, const void* payload)
+	{
+		return sendAll(fd, &header, sizeof(header)) && sendAll(fd, payload, header.getPayloadSize());
+	}
+
+	static bool receiveHeader(int fd, MessageHeader& header)
+	{
+		return receiveAll(fd, &header, sizeof(header)) && header.magic == MessageHeader::MAGIC;
+	}
+};
+
+
+/*
+	Worker side, lives in its own process and evaluates the batches it receives
+*/
+struct DistributedWorker
+{
+	int fd;
+	sf::Vector2f area_size;
+	uint32_t thread_count;
+	std::unique_ptr<Stadium> stadium;
+	std::vector<uint8_t> slab;
+	std::vector<float> fitness;
+
+	DistributedWorker(int fd_, sf::Vector2f area_size_, uint32_t thread_count_)
+		: fd(fd_)
+		, area_size(area_size_)
+		, thread_count(thread_count_)
+	{}
+
+	void run(float dt)
+	{
+		MessageHeader header;
+		while (Socket::receiveHeader(fd, header) && header.type == MessageHeader::Evaluate) {
+			slab.resize(header.getPayloadSize());
+			if (!Socket::receiveAll(fd, slab.data(), slab.size())) {
+				break;
+			}
+
+			evaluate(header, dt);
+
+			MessageHeader result = header;
+			result.type = MessageHeader::Result;
+			result.element_bytes = sizeof(float);
+			if (!Socket::sendMessage(fd, result, fitness.data())) {
+				break;
+			}
+		}
+		::close(fd);
+	}
+
+	void evaluate(const MessageHeader& header, float dt)
+	{
+		if (!stadium || stadium->population_size != header.count) {
+			stadium = std::make_unique<Stadium>(header.count, area_size, thread_count);
+		}
+
+		std::vector<Drone>& drones = stadium->selector.getCurrentPopulation();
+		DNA dna(header.element_bytes * 8);
+		for (uint32_t i(0); i < header.count; ++i) {
+			memcpy(dna.code.data(), &slab[uint64_t(i) * header.element_bytes], header.element_bytes);
+			drones[i].loadDNA(dna);
+		}
+
+		stadium->setTargetsSeed(header.scenario_seed);
+		stadium->evaluatePopulation(dt);
+
+		fitness.resize(header.count);
+		for (uint32_t i(0); i < header.count; ++i) {
+			fitness[i] = drones[i].fitness;
+		}
+	}
+};
+
+
+/*
+	Coordinator side, owns the Selector and sends batches of genomes to worker processes.
+	Workers are forked in the constructor so it has to be created before any other thread.
+*/
+struct DistributedCoordinator
+{
+	struct WorkerProcess
+	{
+		pid_t pid;
+		int fd;
+		bool alive;
+	};
+
+	struct Batch
+	{
+		uint32_t start;
+		uint32_t count;
+	};
+
+	Selector<Drone> selector;
+	std::vector<WorkerProcess> workers;
+	std::vector<uint8_t> slab;
+	uint32_t base_seed;
+
+	DistributedCoordinator(uint32_t workers_count, uint32_t population, sf::Vector2f area_size, float dt, uint32_t seed = 0)
+		: selector(population)
+		, base_seed(seed)
+	{
+		const uint32_t thread_count = std::max(1u, swrm::Topology::get().getDefaultThreadCount() / std::max(1u, workers_count));
+		for (uint32_t i(0); i < workers_count; ++i) {
+			int fds[2];
+			if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+				std::cout << "Cannot create socket pair for worker " << i << std::endl;
+				continue;
+			}
+			Socket::disableSigpipe(fds[0]);
+			Socket::disableSigpipe(fds[1]);
+
+			const pid_t pid = ::fork();
+			if (pid == 0) {
+				::close(fds[0]);
+				// Do not keep the sockets of the previous workers open
+				for (const WorkerProcess& worker : workers) {
+					::close(worker.fd);
+				}
+				DistributedWorker(fds[1], area_size, thread_count).run(dt);
+				::_exit(0);
+			}
+
+			::close(fds[1]);
+			if (pid < 0) {
+				std::cout << "Cannot fork worker " << i << std::endl;
+				::close(fds[0]);
+				continue;
+			}
+			workers.push_back({pid, fds[0], true});
+		}
+	}
+
+	~DistributedCoordinator()
+	{
+		const MessageHeader stop{MessageHeader::MAGIC, MessageHeader::Stop, 0, 0, 0, 0};
+		for (WorkerProcess& worker : workers) {
+			if (worker.alive) {
+				Socket::sendAll(worker.fd, &stop, sizeof(stop));
+				::close(worker.fd);
+			}
+			::waitpid(worker.pid, nullptr, 0);
+		}
+	}
+
+	uint32_t getAliveWorkersCount() const
+	{
+		uint32_t result = 0;
+		for (const WorkerProcess& worker : workers) {
+			result += worker.alive;
+		}
+		return result;
+	}
+
+	// Evaluates the current population on the workers, returns false if none is left
+	bool evaluate()
+	{
+		std::vector<Drone>& population = selector.getCurrentPopulation();
+		const uint32_t population_size = as<uint32_t>(population.size());
+		const uint32_t scenario_seed = base_seed + selector.generation;
+
+		std::list<Batch> pending;
+		const uint32_t batches_count = std::max(1u, getAliveWorkersCount());
+		for (uint32_t i(0); i < batches_count; ++i) {
+			const uint32_t start = i * population_size / batches_count;
+			const uint32_t end   = (i + 1) * population_size / batches_count;
+			pending.push_back({start, end - start});
+		}
+
+		while (!pending.empty()) {
+			if (!getAliveWorkersCount()) {
+				std::cout << "No worker left" << std::endl;
+				return false;
+			}
+
+			// Dispatch one batch per alive worker
+			std::vector<std::pair<WorkerProcess*, Batch>> in_flight;
+			for (WorkerProcess& worker : workers) {
+				if (!worker.alive || pending.empty()) {
+					continue;
+				}
+				const Batch batch = pending.front();
+				pending.pop_front();
+				if (sendBatch(worker, batch, scenario_seed)) {
+					in_flight.emplace_back(&worker, batch);
+				}
+				else {
+					onWorkerLost(worker);
+					pending.push_back(batch);
+				}
+			}
+
+			// Collect results, batches of crashed workers are sent again
+			for (auto& job : in_flight) {
+				if (!receiveResult(*job.first, job.second)) {
+					onWorkerLost(*job.first);
+					pending.push_back(job.second);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void run(uint32_t generations_count)
+	{
+		while (!generations_count || selector.generation < generations_count) {
+			if (!evaluate()) {
+				break;
+			}
+			selector.nextGeneration();
+		}
+	}
+
+private:
+	bool sendBatch(WorkerProcess& worker, const Batch& batch, uint32_t scenario_seed)
+	{
+		const std::vector<Drone>& population = selector.getCurrentPopulation();
+		const uint32_t genome_bytes = as<uint32_t>(population.front().dna.getBytesCount());
+		slab.resize(uint64_t(batch.count) * genome_bytes);
+		for (uint32_t i(0); i < batch.count; ++i) {
+			memcpy(&slab[uint64_t(i) * genome_bytes], population[batch.start + i].dna.code.data(), genome_bytes);
+		}
+
+		const MessageHeader header{MessageHeader::MAGIC, MessageHeader::Evaluate, selector.generation, scenario_seed, batch.count, genome_bytes};
+		return Socket::sendMessage(worker.fd, header, slab.data());
+	}
+
+	bool receiveResult(WorkerProcess& worker, const Batch& batch)
+	{
+		MessageHeader header;
+		if (!Socket::receiveHeader(worker.fd, header) || header.type != MessageHeader::Result || header.count != batch.count) {
+			return false;
+		}
+
+		std::vector<float> fitness(header.count);
+		if (!Socket::receiveAll(worker.fd, fitness.data(), header.getPayloadSize())) {
+			return false;
+		}
+
+		std::vector<Drone>& population = selector.getCurrentPopulation();
+		for (uint32_t i(0); i < batch.count; ++i) {
+			population[batch.start + i].fitness = fitness[i];
+		}
+		return true;
+	}
+
+	void onWorkerLost(WorkerProcess& worker)
+	{
+		std::cout << "Lost worker " << worker.pid << ", its batch will be evaluated again" << std::endl;
+		worker.alive = false;
+		::close(worker.fd);
+	}
+};
+
+#endif
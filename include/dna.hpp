@@ -5,15 +5,26 @@
 #include "number_generator.hpp"
 #include <cstring>
 #include "utils.hpp"
+#include "half.hpp"
 
 constexpr float MAX_RANGE = 10.0f;
 
+enum class GeneEncoding
+{
+	Float32,
+	Float16,
+	BFloat16
+};
+
+// Storage of the genes for the whole process, to be set before any genome is created
+inline GeneEncoding gene_encoding = GeneEncoding::Float32;
+
 
 struct DNA
 {
 	using byte = uint8_t;
 
-	DNA(const uint64_t bits_count)
+	DNA(const uint64_t bits_count = 0)
 		: code(bits_count / 8u + bool(bits_count % 8 && bits_count > 8))
 	{}
 
@@ -44,6 +55,71 @@ struct DNA
 		memcpy(&code[dna_offset], &value, sizeof(T));
 	}
 
+	static uint64_t getGeneBytes()
+	{
+		return gene_encoding == GeneEncoding::Float32 ? 4 : 2;
+	}
+
+	uint64_t getGenesCount() const
+	{
+		return code.size() / getGeneBytes();
+	}
+
+	// Genes are always handled as floats, only their storage depends on the encoding
+	float getGene(const uint64_t i) const
+	{
+		if (gene_encoding == GeneEncoding::Float32) {
+			return get<float>(i);
+		}
+		const uint16_t h = get<uint16_t>(i);
+		return gene_encoding == GeneEncoding::Float16 ? half::toFloat(h) : half::bf16ToFloat(h);
+	}
+
+	void setGene(const uint64_t i, float value)
+	{
+		if (gene_encoding == GeneEncoding::Float32) {
+			set<float>(i, value);
+		}
+		else {
+			const uint16_t h = gene_encoding == GeneEncoding::Float16 ? half::fromFloat(value) : half::bf16FromFloat(value);
+			memcpy(&code[i * 2], &h, 2);
+		}
+	}
+
+	// Decodes count consecutive genes
+	void getGenes(const uint64_t first, const uint64_t count, float* out) const
+	{
+		const uint64_t bytes = getGeneBytes();
+		if (gene_encoding == GeneEncoding::Float32) {
+			memcpy(out, &code[first * bytes], count * bytes);
+		}
+		else if (gene_encoding == GeneEncoding::Float16) {
+			half::toFloat(reinterpret_cast<const uint16_t*>(&code[first * bytes]), out, count);
+		}
+		else {
+			for (uint64_t i(0); i < count; ++i) {
+				out[i] = getGene(first + i);
+			}
+		}
+	}
+
+	void initializeGenes(const float range)
+	{
+		for (uint64_t i(getGenesCount()); i--;) {
+			setGene(i, NumberGenerator<>::getInstance().get(range));
+		}
+	}
+
+	void mutateGenes(const float probability)
+	{
+		const uint64_t genes_count = getGenesCount();
+		for (uint64_t i(0); i < genes_count; ++i) {
+			if (NumberGenerator<>::getInstance().getUnder(1.0f) < probability) {
+				setGene(i, NumberGenerator<>::getInstance().get(MAX_RANGE));
+			}
+		}
+	}
+
 	uint64_t getBytesCount() const
 	{
 		return code.size();
@@ -2,12 +2,24 @@
 #include "dna.hpp"
 
 
+/*
+	Every operator also writes into an existing genome, which only allocates when the genome
+	has to grow: breeding into the next population buffer reuses its storage.
+	The result must not be one of the parents.
+*/
 struct DNAUtils
 {
 	static DNA crossover(const DNA& dna1, const DNA& dna2, const uint64_t cross_point)
+	{
+		DNA result;
+		crossover(dna1, dna2, cross_point, result);
+		return result;
+	}
+
+	static void crossover(const DNA& dna1, const DNA& dna2, const uint64_t cross_point, DNA& result)
 	{
 		const uint64_t code_size = dna1.code.size();
-		DNA result(code_size * 8);
+		result.code.resize(code_size);
 
 		for (uint64_t i(0); i < cross_point; ++i) {
 			result.code[i] = dna1.code[i];
@@ -15,41 +27,67 @@ struct DNAUtils
 		for (uint64_t i(cross_point); i < code_size; ++i) {
 			result.code[i] = dna2.code[i];
 		}
-
-		return result;
 	}
 
-	template<typename T>
 	static DNA makeChild(const DNA& dna1, const DNA& dna2, const float mutation_probability)
 	{
-		const uint64_t point1 = getIntUnderNonReset(as<uint32_t>(dna1.getBytesCount()));
-		DNA child_dna = crossover(dna1, dna2, point1);
-		const uint64_t element_count = dna1.getElementsCount<T>();
-		for (uint64_t i(element_count); i--;) {
+		DNA child_dna;
+		makeChild(dna1, dna2, mutation_probability, child_dna);
+		return child_dna;
+	}
+
+	// Genes are mutated as floats whatever their storage
+	static void makeChild(const DNA& dna1, const DNA& dna2, const float mutation_probability, DNA& child_dna)
+	{
+		const uint64_t point1 = NumberGenerator<>::getInstance().getIntUnder(as<uint32_t>(dna1.getBytesCount()));
+		crossover(dna1, dna2, point1, child_dna);
+		const uint64_t genes_count = dna1.getGenesCount();
+		for (uint64_t i(genes_count); i--;) {
 			const float distrib = 1.0f + NumberGenerator<>::getInstance().get(mutation_probability);
-			child_dna.set(i, child_dna.get<float>(i) * distrib);
+			child_dna.setGene(i, child_dna.getGene(i) * distrib);
 		}
-		child_dna.mutate<float>(mutation_probability);
+		child_dna.mutateGenes(mutation_probability);
+	}
+
+	static DNA breed(const DNA& dna1, float fitness1, const DNA& dna2, float fitness2)
+	{
+		DNA child_dna;
+		breed(dna1, fitness1, dna2, fitness2, child_dna);
 		return child_dna;
 	}
 
-	template<typename T>
+	// Offspring of two selected parents, mutation gets lower as parents get better
+	static void breed(const DNA& dna1, float fitness1, const DNA& dna2, float fitness2, DNA& child_dna)
+	{
+		const float mutation_proba = 1.0f / sqrt(fitness1 + fitness2);
+		if (dna1 == dna2) {
+			evolve(dna1, mutation_proba, mutation_proba, child_dna);
+			return;
+		}
+		makeChild(dna1, dna2, mutation_proba, child_dna);
+	}
+
 	static DNA evolve(const DNA& dna, float mutation_probability, float range)
 	{
-		DNA child_dna = dna;
-		optimize<T>(child_dna, mutation_probability, range);
+		DNA child_dna;
+		evolve(dna, mutation_probability, range, child_dna);
 		return child_dna;
 	}
 
-	template<typename T>
+	static void evolve(const DNA& dna, float mutation_probability, float range, DNA& child_dna)
+	{
+		child_dna = dna;
+		optimize(child_dna, mutation_probability, range);
+	}
+
 	static void optimize(DNA& dna, float probability, float range)
 	{
-		const uint64_t element_count = dna.getElementsCount<T>();
-		for (uint64_t i(element_count); i--;) {
+		const uint64_t genes_count = dna.getGenesCount();
+		for (uint64_t i(genes_count); i--;) {
 			if (pass(probability)) {
-				const T value = dna.get<T>(i);
-				const T random_offset = NumberGenerator<>::getInstance().get(range * MAX_RANGE);
-				dna.set(i, value + random_offset);
+				const float value = dna.getGene(i);
+				const float random_offset = NumberGenerator<>::getInstance().get(range * MAX_RANGE);
+				dna.setGene(i, value + random_offset);
 			}
 		}
 	}
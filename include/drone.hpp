@@ -9,6 +9,39 @@
 
 
 const std::vector<uint64_t> architecture = { 7, 9, 9, 4 };
+// Controls a single thruster, the right one is driven by the mirrored inputs
+const std::vector<uint64_t> mirrored_architecture = { 7, 6, 6, 2 };
+// Controller of the drones created from now on
+inline bool mirrored_controller = false;
+
+inline const std::vector<uint64_t>& getArchitecture()
+{
+	return mirrored_controller ? mirrored_architecture : architecture;
+}
+
+// Architectures competing in the same population, drones start in the first one
+inline std::vector<std::vector<uint64_t>> architecture_buckets;
+
+inline uint32_t getBucketsCount()
+{
+	return std::max(1u, static_cast<uint32_t>(architecture_buckets.size()));
+}
+
+inline const std::vector<uint64_t>& getBucketArchitecture(uint32_t bucket)
+{
+	return architecture_buckets.empty() ? getArchitecture() : architecture_buckets[bucket];
+}
+
+// Genomes don't carry their architecture, it is found back from their length
+inline uint32_t getBucketForGenes(uint64_t genes_count)
+{
+	for (uint32_t i(0); i < architecture_buckets.size(); ++i) {
+		if (Network::getParametersCount(architecture_buckets[i]) == genes_count) {
+			return i;
+		}
+	}
+	return 0;
+}
 
 
 struct Drone : public AiUnit
@@ -65,13 +98,16 @@ struct Drone : public AiUnit
 	float angle;
 	float angular_velocity;
 	uint32_t index;
+	bool mirrored;
+	std::vector<float> controller_rows;
 
 	Drone()
-		: AiUnit(architecture)
+		: AiUnit(getBucketArchitecture(0))
 		, radius(20.0f)
 		, position(0.0f, 0.0f)
+		, mirrored(mirrored_controller)
 	{
-
+		reserveControllerRows();
 	}
 
 	void loadDNAFromFile(const std::string& filename)
@@ -80,17 +116,19 @@ struct Drone : public AiUnit
 		float value;
 		uint32_t i(0);
 		while (infile >> value) {
-			dna.set<float>(i, value);
+			dna.setGene(i, value);
 			++i;
 		}
 		infile.close();
 	}
 
 	Drone(const sf::Vector2f& pos)
-		: AiUnit(architecture)
+		: AiUnit(getBucketArchitecture(0))
 		, radius(20.0f)
 		, position(pos)
+		, mirrored(mirrored_controller)
 	{
+		reserveControllerRows();
 	}
 
 	void reset()
@@ -155,6 +193,51 @@ struct Drone : public AiUnit
 		return getAngle(sf::Vector2f(cos(angle), sin(angle))) / PI;
 	}
 
+	void setBucket(uint32_t new_bucket) override
+	{
+		if (new_bucket != bucket) {
+			bucket = new_bucket;
+			setArchitecture(getBucketArchitecture(bucket));
+			reserveControllerRows();
+		}
+	}
+
+	// For genomes coming from outside of the population
+	void loadGenome(const DNA& genome)
+	{
+		setBucket(getBucketForGenes(genome.getGenesCount()));
+		loadDNA(genome);
+	}
+
+	// Both thrusters rows, sized once instead of on the first update
+	void reserveControllerRows()
+	{
+		if (mirrored) {
+			controller_rows.resize(2 * network.input_size);
+			network.reserveRows(2);
+		}
+	}
+
+	// The mirrored controller only has a dense version, both thrusters are evaluated in one pass
+	void execute(const std::vector<float>& inputs)
+	{
+		if (!mirrored) {
+			AiUnit::execute(inputs);
+			return;
+		}
+
+		const uint64_t inputs_count = inputs.size();
+		controller_rows.resize(2 * inputs_count);
+		std::copy(inputs.begin(), inputs.end(), controller_rows.begin());
+		std::copy(inputs.begin(), inputs.end(), controller_rows.begin() + inputs_count);
+		// Reflection through the vertical axis: target x, horizontal velocity, sin(angle) and angular velocity
+		for (const uint64_t i : {0, 2, 5, 6}) {
+			controller_rows[inputs_count + i] = -controller_rows[inputs_count + i];
+		}
+		// Rows outputs are [left power, left angle, right power, right angle], the layout process expects
+		process(network.executeRows(controller_rows, 2));
+	}
+
 	void process(const std::vector<float>& outputs) override
 	{
 		left.setPower(0.5f * (outputs[0] + 1.0f));
@@ -6,12 +6,17 @@
 
 struct DroneRenderer
 {
+	static constexpr uint32_t body_quality = 24;
+
 	sf::Texture flame;
 	sf::Sprite flame_sprite;
 	sf::Texture smoke;
 	sf::Sprite smoke_sprite;
+	// Body outline, rebuilt for every drone without reallocating
+	sf::VertexArray body_va;
 	
 	DroneRenderer()
+		: body_va(sf::TriangleFan, body_quality + 3)
 	{
 		BaseManager::RegisterTexture("flame.png", "flame");
 		BaseManager::RegisterTexture("smoke.png", "smoke");
@@ -126,8 +131,8 @@ struct DroneRenderer
 		const sf::Color eye_color = getRedGreenRatio(angle_ratio);
 
 		const float r = drone.radius * 1.25f;
-		const uint32_t quality = 24;
-		sf::VertexArray va(sf::TriangleFan, quality + 3);
+		const uint32_t quality = body_quality;
+		sf::VertexArray& va = body_va;
 		const float da = 2.0f * PI / float(quality);
 		va[0].position = drone.position;
 		va[0].color = eye_color;
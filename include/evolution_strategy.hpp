@@ -0,0 +1,184 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include <memory>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <swarm.hpp>
+#include "optimizer.hpp"
+
+
+/*
+	Large block of precomputed gaussian noise shared by everyone using the same seed,
+	a perturbation is then just an offset in the table.
+*/
+struct NoiseTable
+{
+	std::vector<float> noise;
+
+	NoiseTable(uint64_t size, uint32_t seed)
+		: noise(size)
+	{
+		std::mt19937 generator(seed);
+		std::normal_distribution<float> normal;
+		for (float& value : noise) {
+			value = normal(generator);
+		}
+	}
+
+	const float* get(uint64_t offset) const
+	{
+		return &noise[offset];
+	}
+
+	uint64_t sampleOffset(std::mt19937& generator, uint64_t dimension) const
+	{
+		std::uniform_int_distribution<uint64_t> distribution(0, noise.size() - dimension);
+		return distribution(generator);
+	}
+};
+
+
+/*
+	OpenAI style Evolution Strategy with mirrored sampling and rank centered fitness shaping.
+	Genomes are theta + sign * sigma * noise[offset], only (offset, sign) identifies them.
+	With an odd population the last genome is theta itself.
+*/
+struct EsOptimizer : public Optimizer
+{
+	struct Perturbation
+	{
+		uint64_t offset;
+		float sign;
+	};
+
+	const uint64_t n;
+	std::shared_ptr<const NoiseTable> table;
+	float sigma;
+	float learning_rate;
+	float l2_coefficient;
+
+	std::vector<float> theta;
+	std::vector<Perturbation> perturbations;
+	std::vector<float> shaped;
+	std::vector<float> gradient;
+	// Adam state
+	std::vector<float> moment_1;
+	std::vector<float> moment_2;
+	uint64_t step;
+
+	std::mt19937 generator;
+	// The stadium's workers, idle while the generation is bred
+	swrm::Swarm& swarm;
+
+	EsOptimizer(uint64_t dimension, std::shared_ptr<const NoiseTable> noise_table, swrm::Swarm& swarm_, uint32_t seed = 0)
+		: n(dimension)
+		, table(noise_table)
+		, sigma(0.1f)
+		, learning_rate(0.05f)
+		, l2_coefficient(0.005f)
+		, theta(dimension)
+		, gradient(dimension)
+		, moment_1(dimension, 0.0f)
+		, moment_2(dimension, 0.0f)
+		, step(0)
+		, generator(seed)
+		, swarm(swarm_)
+	{
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+		for (float& value : theta) {
+			value = distribution(generator);
+		}
+	}
+
+	void ask(std::vector<DNA>& genomes) override
+	{
+		const uint64_t count = genomes.size();
+		perturbations.resize(count);
+		for (uint64_t k(0); k + 1 < count; k += 2) {
+			const uint64_t offset = table->sampleOffset(generator, n);
+			perturbations[k]     = {offset,  1.0f};
+			perturbations[k + 1] = {offset, -1.0f};
+		}
+		if (count % 2) {
+			perturbations.back() = {0, 0.0f};
+		}
+
+		for (uint64_t k(0); k < count; ++k) {
+			makeGenome(perturbations[k], genomes[k]);
+		}
+	}
+
+	// Anyone with the same table and theta can rebuild a genome from its perturbation
+	void makeGenome(const Perturbation& perturbation, DNA& genome) const
+	{
+		const float* noise = table->get(perturbation.offset);
+		const float scale = perturbation.sign * sigma;
+		for (uint64_t i(0); i < n; ++i) {
+			genome.setGene(i, theta[i] + scale * noise[i]);
+		}
+	}
+
+	void tell(const std::vector<float>& fitness) override
+	{
+		const uint64_t count = std::min(fitness.size(), perturbations.size());
+		const uint64_t pairs_count = count / 2;
+		if (!pairs_count) {
+			return;
+		}
+
+		computeRanks(fitness, count);
+
+		// Each thread sums all the noise slices over its part of the parameters
+		auto group = swarm.execute([&](uint32_t thread_id, uint32_t max_thread) {
+			const uint64_t start = thread_id * n / max_thread;
+			const uint64_t end   = (thread_id + 1) * n / max_thread;
+			std::fill(gradient.begin() + start, gradient.begin() + end, 0.0f);
+			for (uint64_t j(0); j < pairs_count; ++j) {
+				const float weight = shaped[2 * j] - shaped[2 * j + 1];
+				const float* noise = table->get(perturbations[2 * j].offset);
+				for (uint64_t i(start); i < end; ++i) {
+					gradient[i] += weight * noise[i];
+				}
+			}
+		});
+		group.waitExecutionDone();
+
+		const float normalization = 1.0f / float(2 * pairs_count);
+		for (uint64_t i(0); i < n; ++i) {
+			gradient[i] = gradient[i] * normalization - l2_coefficient * theta[i];
+		}
+		applyAdam();
+	}
+
+private:
+	// Ranks mapped to [-0.5, 0.5], only the order of fitness matters
+	void computeRanks(const std::vector<float>& fitness, uint64_t count)
+	{
+		std::vector<uint64_t> order(count);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) { return fitness[a] < fitness[b]; });
+		shaped.resize(count);
+		const float denominator = float(std::max<uint64_t>(1, count - 1));
+		for (uint64_t r(0); r < count; ++r) {
+			shaped[order[r]] = float(r) / denominator - 0.5f;
+		}
+	}
+
+	void applyAdam()
+	{
+		const float beta_1 = 0.9f;
+		const float beta_2 = 0.999f;
+		const float epsilon = 1e-8f;
+		++step;
+		const float corrected_rate = learning_rate * std::sqrt(1.0f - std::pow(beta_2, float(step))) / (1.0f - std::pow(beta_1, float(step)));
+		for (uint64_t i(0); i < n; ++i) {
+			moment_1[i] = beta_1 * moment_1[i] + (1.0f - beta_1) * gradient[i];
+			moment_2[i] = beta_2 * moment_2[i] + (1.0f - beta_2) * gradient[i] * gradient[i];
+			// Ascent, fitness is maximized
+			theta[i] += corrected_rate * moment_1[i] / (std::sqrt(moment_2[i]) + epsilon);
+		}
+	}
+};
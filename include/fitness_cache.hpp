@@ -0,0 +1,117 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <cstring>
+#include "dna.hpp"
+
+
+/*
+	Fitness of already evaluated genomes, only valid when scenarios are the same from a generation to another.
+	Entries are keyed by a hash of the genome bytes and the scenario id, the least recently used is evicted first.
+*/
+struct FitnessCache
+{
+	struct Key
+	{
+		uint64_t genome_hash;
+		uint64_t scenario_id;
+
+		bool operator==(const Key& other) const
+		{
+			return genome_hash == other.genome_hash && scenario_id == other.scenario_id;
+		}
+	};
+
+	struct KeyHash
+	{
+		uint64_t operator()(const Key& key) const
+		{
+			return key.genome_hash ^ mix(key.scenario_id);
+		}
+	};
+
+	struct Entry
+	{
+		Key key;
+		float fitness;
+	};
+
+	uint64_t capacity;
+	std::list<Entry> entries;
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+	uint64_t hits;
+	uint64_t lookups;
+
+	FitnessCache(uint64_t capacity_ = 1 << 16)
+		: capacity(capacity_)
+		, hits(0)
+		, lookups(0)
+	{}
+
+	bool find(const Key& key, float& fitness)
+	{
+		++lookups;
+		const auto it = index.find(key);
+		if (it == index.end()) {
+			return false;
+		}
+		// Move it to the front, it is now the most recently used
+		entries.splice(entries.begin(), entries, it->second);
+		fitness = it->second->fitness;
+		++hits;
+		return true;
+	}
+
+	void add(const Key& key, float fitness)
+	{
+		const auto it = index.find(key);
+		if (it != index.end()) {
+			it->second->fitness = fitness;
+			entries.splice(entries.begin(), entries, it->second);
+			return;
+		}
+
+		entries.push_front({key, fitness});
+		index[key] = entries.begin();
+		if (entries.size() > capacity) {
+			index.erase(entries.back().key);
+			entries.pop_back();
+		}
+	}
+
+	float getHitRatio() const
+	{
+		return lookups ? float(hits) / float(lookups) : 0.0f;
+	}
+
+	static uint64_t mix(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	// Processes 8 bytes at a time, the tail is padded with zeros
+	static uint64_t hash(const DNA& dna)
+	{
+		const uint64_t size = dna.getBytesCount();
+		const uint8_t* data = dna.code.data();
+		uint64_t h = 0x9e3779b97f4a7c15ULL ^ size;
+		uint64_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			memcpy(&word, data + i, 8);
+			h = mix(h ^ word) + 0x9e3779b97f4a7c15ULL;
+		}
+		if (i < size) {
+			uint64_t word = 0;
+			memcpy(&word, data + i, size - i);
+			h = mix(h ^ word);
+		}
+		return h;
+	}
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+
+/*
+	Keeps track of the current selection cutoff and of the drones retired before the end of the iteration.
+	With slack = 1 the bound is exact and selection is unchanged, lower values prune more aggressively.
+	Fitness only grows, so a cutoff taken a few steps ago is lower than the current one and checking
+	every check_period steps prunes later but never wrongly.
+*/
+struct FitnessPruner
+{
+	float slack = 1.0f;
+	uint32_t check_period = 16;
+	uint64_t steps = 0;
+	uint64_t pruned_count = 0;
+	// Steps that would have been simulated if the pruned drones had survived until the end
+	uint64_t saved_steps = 0;
+	std::vector<float> scores;
+
+	// Fitness of the rank-th best unit, the last one to survive selection
+	template<typename T>
+	float getCutoff(const std::vector<T>& units, uint32_t rank)
+	{
+		if (!rank || rank > units.size()) {
+			return 0.0f;
+		}
+
+		scores.resize(units.size());
+		for (uint64_t i(0); i < units.size(); ++i) {
+			scores[i] = units[i].fitness;
+		}
+		std::nth_element(scores.begin(), scores.begin() + (rank - 1), scores.end(), [](float a, float b) { return a > b; });
+		return scores[rank - 1];
+	}
+
+	// Called once per step
+	bool isCheckDue()
+	{
+		return !(++steps % check_period);
+	}
+
+	bool isHopeless(float fitness, float upper_bound, float cutoff) const
+	{
+		return fitness + slack * upper_bound < cutoff;
+	}
+
+	void onPruned(uint64_t remaining_steps)
+	{
+		++pruned_count;
+		saved_steps += remaining_steps;
+	}
+
+	void resetStats()
+	{
+		pruned_count = 0;
+		saved_steps = 0;
+	}
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#if defined(__F16C__)
+	#include <immintrin.h>
+#endif
+
+
+/*
+	16 bits float conversions, IEEE half and bfloat16 (upper half of a float).
+	Both round to nearest even, the F16C instructions are used for halves when available.
+	The fallback gives the same bits, NaN payloads included (truncated and quieted).
+*/
+namespace half
+{
+
+inline uint16_t fromFloat(float value)
+{
+#if defined(__F16C__)
+	return static_cast<uint16_t>(_cvtss_sh(value, 0));
+#else
+	uint32_t x;
+	memcpy(&x, &value, 4);
+	const uint32_t sign = (x >> 16) & 0x8000;
+	const uint32_t abs = x & 0x7FFFFFFF;
+	if (abs >= 0x7F800000) {
+		// Inf stays inf, NaN keeps the top of its payload and is quieted
+		return static_cast<uint16_t>(sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 | ((abs >> 13) & 0x3FF) : 0));
+	}
+	if (abs >= 0x477FF000) {
+		// Rounds above the largest half
+		return static_cast<uint16_t>(sign | 0x7C00);
+	}
+	if (abs < 0x38800000) {
+		// Subnormal half or zero
+		if (abs < 0x33000000) {
+			return static_cast<uint16_t>(sign);
+		}
+		const uint32_t mantissa = (abs & 0x7FFFFF) | 0x800000;
+		const uint32_t shift = 126 - (abs >> 23);
+		uint32_t h = mantissa >> shift;
+		const uint32_t rest = mantissa & ((1u << shift) - 1);
+		const uint32_t middle = 1u << (shift - 1);
+		h += (rest > middle || (rest == middle && (h & 1)));
+		return static_cast<uint16_t>(sign | h);
+	}
+	// Exponent rebiased from 127 to 15, a rounding carry correctly moves to the exponent
+	uint32_t h = (abs - 0x38000000) >> 13;
+	const uint32_t rest = abs & 0x1FFF;
+	h += (rest > 0x1000 || (rest == 0x1000 && (h & 1)));
+	return static_cast<uint16_t>(sign | h);
+#endif
+}
+
+inline float toFloat(uint16_t h)
+{
+#if defined(__F16C__)
+	return _cvtsh_ss(h);
+#else
+	const uint32_t sign = uint32_t(h & 0x8000) << 16;
+	const uint32_t exponent = (h >> 10) & 0x1F;
+	const uint32_t mantissa = h & 0x3FF;
+	uint32_t x;
+	if (exponent == 0) {
+		const float value = std::ldexp(float(mantissa), -24);
+		return sign ? -value : value;
+	}
+	else if (exponent == 31) {
+		// NaN are quieted
+		x = sign | 0x7F800000 | (mantissa ? 0x400000 | (mantissa << 13) : 0);
+	}
+	else {
+		x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	float result;
+	memcpy(&result, &x, 4);
+	return result;
+#endif
+}
+
+// Bulk version used when binding genes to a network
+inline void toFloat(const uint16_t* in, float* out, uint64_t count)
+{
+	uint64_t i(0);
+#if defined(__F16C__)
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+	}
+#endif
+	for (; i < count; ++i) {
+		out[i] = toFloat(in[i]);
+	}
+}
+
+inline uint16_t bf16FromFloat(float value)
+{
+	uint32_t x;
+	memcpy(&x, &value, 4);
+	if ((x & 0x7FFFFFFF) > 0x7F800000) {
+		return static_cast<uint16_t>((x >> 16) | 0x40);
+	}
+	x += 0x7FFF + ((x >> 16) & 1);
+	return static_cast<uint16_t>(x >> 16);
+}
+
+inline float bf16ToFloat(uint16_t h)
+{
+	const uint32_t x = uint32_t(h) << 16;
+	float result;
+	memcpy(&result, &x, 4);
+	return result;
+}
+
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <chrono>
+#include <functional>
+#include "stadium.hpp"
+#include "mailbox.hpp"
+
+
+enum class MigrationTopology
+{
+	Ring,
+	Random
+};
+
+
+/*
+	Runs several independent populations (islands) in parallel, each one in its own thread
+	with its own Swarm and random stream. Every migration_interval generations, the best genomes
+	of each island are sent to another one where they replace the weakest units.
+	Islands bred by an optimizer don't migrate: a migrant would be credited to the candidate
+	it replaced on the optimizer's next update.
+*/
+struct IslandRunner
+{
+	struct Island
+	{
+		Island(uint32_t population, sf::Vector2f area_size, uint32_t thread_count, uint32_t seed, uint64_t mailbox_capacity)
+			: generator(false)
+			, stadium(population, area_size, thread_count)
+			, inbox(mailbox_capacity)
+		{
+			generator.seed(seed);
+			stadium.setTargetsSeed(seed);
+		}
+
+		NumberGenerator<> generator;
+		Stadium stadium;
+		Mailbox<DNA> inbox;
+		std::thread thread;
+	};
+
+	std::vector<std::unique_ptr<Island>> islands;
+	MigrationTopology topology;
+	uint32_t migration_interval;
+	uint32_t migrants_count;
+	std::atomic<bool> running;
+	// Stops all islands as soon as one reaches it, 0 to disable
+	float target_fitness;
+	// Called by the first island after each of its generations, from its thread
+	std::function<void(uint32_t)> on_generation;
+	std::chrono::steady_clock::time_point start_time;
+
+	IslandRunner(uint32_t islands_count, uint32_t population, sf::Vector2f area_size, uint32_t seed = 0, uint32_t threads_per_island = 0)
+		: topology(MigrationTopology::Ring)
+		, migration_interval(10)
+		, migrants_count(std::max(1u, as<uint32_t>(population * population_elite_ratio)))
+		, running(false)
+		, target_fitness(0.0f)
+	{
+		if (!threads_per_island) {
+			// Split the machine in one core group per island
+			threads_per_island = std::max(1u, swrm::Topology::get().getDefaultThreadCount() / std::max(1u, islands_count));
+		}
+
+		for (uint32_t i(0); i < islands_count; ++i) {
+			// Each island can receive from every other one in the random topology
+			const uint64_t capacity = 2 * migrants_count * islands_count;
+			islands.push_back(std::make_unique<Island>(population, area_size, threads_per_island, seed + i, capacity));
+			std::stringstream sstr;
+			sstr << "../selector_output_island_" << i << ".bin";
+			islands.back()->stadium.selector.out_file = sstr.str();
+			// Migrants have to be in before the generation is prescreened or served from the cache
+			islands.back()->stadium.on_bred = [this, i] {
+				immigrate(i);
+			};
+		}
+	}
+
+	~IslandRunner()
+	{
+		stop();
+	}
+
+	void start(float dt, uint32_t generations_count = 0)
+	{
+		running = true;
+		start_time = std::chrono::steady_clock::now();
+		for (uint32_t i(0); i < islands.size(); ++i) {
+			islands[i]->thread = std::thread(&IslandRunner::runIsland, this, i, dt, generations_count);
+		}
+	}
+
+	void stop()
+	{
+		running = false;
+		join();
+	}
+
+	void join()
+	{
+		for (std::unique_ptr<Island>& island : islands) {
+			if (island->thread.joinable()) {
+				island->thread.join();
+			}
+		}
+	}
+
+	// Blocking version, returns once every island reached the requested generation
+	void run(float dt, uint32_t generations_count)
+	{
+		start(dt, generations_count);
+		join();
+		running = false;
+	}
+
+	float getBestFitness() const
+	{
+		float result = 0.0f;
+		for (const std::unique_ptr<Island>& island : islands) {
+			result = std::max(result, island->stadium.getBestFitness());
+		}
+		return result;
+	}
+
+private:
+	void runIsland(uint32_t id, float dt, uint32_t generations_count)
+	{
+		Island& island = *islands[id];
+		Stadium& stadium = island.stadium;
+		NumberGenerator<>::setThreadInstance(&island.generator);
+
+		uint32_t reported_generation = stadium.selector.generation;
+		while (running && (!generations_count || stadium.selector.generation < generations_count)) {
+			if (stadium.isDone()) {
+				const uint32_t generation = stadium.selector.generation;
+				const bool migrate = islands.size() > 1 && !stadium.selector.optimizer && generation && !(generation % migration_interval);
+				stadium.newIteration();
+				if (migrate) {
+					emigrate(id);
+				}
+			}
+			// Steady state generations end during an update
+			if (stadium.selector.generation != reported_generation) {
+				reported_generation = stadium.selector.generation;
+				checkTargetReached(id);
+				if (!id && on_generation) {
+					on_generation(reported_generation);
+				}
+			}
+			stadium.update(dt, false);
+		}
+
+		NumberGenerator<>::setThreadInstance(nullptr);
+	}
+
+	void checkTargetReached(uint32_t id)
+	{
+		const Stadium& stadium = islands[id]->stadium;
+		const Selector<Drone>& selector = stadium.selector;
+		if (target_fitness <= 0.0f || stadium.getBestFitness() < target_fitness) {
+			return;
+		}
+
+		if (running.exchange(false)) {
+			const float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start_time).count();
+			std::cout << "Island " << id << " reached target fitness " << target_fitness << " at generation "
+				<< selector.generation << " after " << elapsed << " s" << std::endl;
+		}
+	}
+
+	uint32_t getDestination(uint32_t id)
+	{
+		const uint32_t islands_count = as<uint32_t>(islands.size());
+		if (topology == MigrationTopology::Ring) {
+			return (id + 1) % islands_count;
+		}
+		// Any island but the sender
+		const uint32_t offset = 1 + islands[id]->generator.getIntUnder(islands_count - 2);
+		return (id + offset) % islands_count;
+	}
+
+	void emigrate(uint32_t id)
+	{
+		// The previous generation, sorted by the selector when breeding the new one
+		const std::vector<Drone>& population = islands[id]->stadium.selector.getNextPopulation();
+		const uint32_t count = std::min(migrants_count, as<uint32_t>(population.size()));
+		for (uint32_t i(0); i < count; ++i) {
+			// Only the genome travels
+			DNA migrant = population[i].dna;
+			islands[getDestination(id)]->inbox.push(migrant);
+		}
+	}
+
+	// Through Stadium::on_bred, the new generation is then initialized as a whole
+	void immigrate(uint32_t id)
+	{
+		if (islands[id]->stadium.selector.optimizer) {
+			return;
+		}
+		std::vector<Drone>& population = islands[id]->stadium.selector.getCurrentPopulation();
+		// Migrants replace the end of the new generation, elites are left untouched
+		uint64_t slot = population.size();
+		DNA migrant;
+		while (slot > 0 && islands[id]->inbox.pop(migrant)) {
+			population[--slot].loadGenome(migrant);
+		}
+	}
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include "stadium.hpp"
+
+
+/*
+	Headless training run with a fixed seed and generations count. Reports the throughput and
+	checks the best fitness of every generation against a golden trajectory, the first run
+	records it. Changes meant to only make training faster must keep the trajectory.
+*/
+struct MacroBenchmark
+{
+	// Relative difference allowed per generation, 0 requires an exact match
+	float tolerance = 0.0f;
+	std::vector<float> trajectory;
+	uint64_t drone_steps = 0;
+	float duration = 0.0f;
+	// Phase timings per generation, when set
+	std::unique_ptr<profiler::CsvExport> profile;
+	profiler::History profile_history;
+
+	// Until generations populations have been evaluated
+	void train(Stadium& stadium, float dt, uint32_t generations)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		uint32_t generation = stadium.selector.generation;
+		while (trajectory.size() < generations) {
+			if (stadium.isDone()) {
+				if (!stadium.isFirstIteration()) {
+					drone_steps += stadium.current_iteration.drone_steps;
+				}
+				stadium.newIteration();
+			}
+			// Steady state generations end during an update
+			if (stadium.selector.generation != generation) {
+				// The first one only starts the evaluation of the initial population
+				if (generation) {
+					trajectory.push_back(stadium.getBestFitness());
+				}
+				generation = stadium.selector.generation;
+				if (profile) {
+					profile->write(generation, profile_history.collect());
+				}
+			}
+			stadium.update(dt, false);
+		}
+		if (stadium.steady_state) {
+			drone_steps += stadium.current_iteration.drone_steps;
+		}
+		duration = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	static std::vector<float> load(const std::string& filename)
+	{
+		std::ifstream file(filename);
+		std::vector<float> result;
+		uint32_t generation;
+		float fitness;
+		while (file >> generation >> fitness) {
+			result.push_back(fitness);
+		}
+		return result;
+	}
+
+	void save(const std::string& filename) const
+	{
+		std::ofstream file(filename);
+		// Enough digits for floats to round trip
+		file << std::setprecision(9);
+		for (uint64_t i(0); i < trajectory.size(); ++i) {
+			file << i << " " << trajectory[i] << "\n";
+		}
+	}
+
+	// Index of the first generation that differs, -1 if none. The run has to cover the golden trajectory, a longer one is compared on the golden generations
+	int64_t compare(const std::vector<float>& golden) const
+	{
+		if (trajectory.size() < golden.size()) {
+			return int64_t(trajectory.size());
+		}
+		const uint64_t count = golden.size();
+		for (uint64_t i(0); i < count; ++i) {
+			const float scale = std::max(1.0f, std::abs(golden[i]));
+			if (std::abs(trajectory[i] - golden[i]) > tolerance * scale) {
+				return int64_t(i);
+			}
+		}
+		return -1;
+	}
+
+	static bool run(Stadium& stadium, float dt, uint32_t generations, const std::string& golden_file, float tolerance, const std::string& profile_file)
+	{
+		MacroBenchmark benchmark;
+		benchmark.tolerance = tolerance;
+		if (!profile_file.empty()) {
+			benchmark.profile = std::make_unique<profiler::CsvExport>(profile_file);
+		}
+		benchmark.train(stadium, dt, generations);
+
+		std::cout << "Macro benchmark, " << generations << " generations of " << stadium.population_size << " drones on " << stadium.swarm.getThreadCount() << " threads" << std::endl;
+		std::cout << "  " << benchmark.duration << " s, " << float(benchmark.trajectory.size()) / benchmark.duration << " generations/s, "
+			<< float(benchmark.drone_steps) / benchmark.duration << " drone steps/s" << std::endl;
+
+		const std::vector<float> golden = load(golden_file);
+		if (golden.empty()) {
+			benchmark.save(golden_file);
+			std::cout << "  Golden trajectory recorded in " << golden_file << std::endl;
+			return true;
+		}
+		const int64_t mismatch = benchmark.compare(golden);
+		if (mismatch < 0) {
+			std::cout << "  Fitness trajectory matches " << golden_file << " on " << golden.size() << " generations" << std::endl;
+			return true;
+		}
+		if (uint64_t(mismatch) == benchmark.trajectory.size()) {
+			std::cout << "  TRAJECTORY TOO SHORT: " << benchmark.trajectory.size() << " generations, golden has " << golden.size() << std::endl;
+			return false;
+		}
+		std::cout << "  TRAJECTORY CHANGED at generation " << mismatch << ": best " << benchmark.trajectory[mismatch] << ", golden " << golden[mismatch] << std::endl;
+		return false;
+	}
+};
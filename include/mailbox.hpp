@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+
+/*
+	Bounded lock-free queue, any number of producers and a single consumer.
+	Each slot carries a sequence number telling whether it is free to write or ready to read.
+*/
+template<typename T>
+struct Mailbox
+{
+	Mailbox(uint64_t capacity_)
+		: capacity(getPowerOfTwo(capacity_))
+		, mask(capacity - 1)
+		, slots(new Slot[capacity])
+		, write_index(0)
+		, read_index(0)
+	{
+		for (uint64_t i(0); i < capacity; ++i) {
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// Returns false if the mailbox is full, the value is then left untouched
+	bool push(T& value)
+	{
+		uint64_t index = write_index.load(std::memory_order_relaxed);
+		while (true) {
+			Slot& slot = slots[index & mask];
+			const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			const int64_t diff = int64_t(sequence) - int64_t(index);
+			if (!diff) {
+				if (write_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+					slot.value = std::move(value);
+					slot.sequence.store(index + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				index = write_index.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool pop(T& value)
+	{
+		const uint64_t index = read_index;
+		Slot& slot = slots[index & mask];
+		if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+			return false;
+		}
+		value = std::move(slot.value);
+		slot.sequence.store(index + capacity, std::memory_order_release);
+		++read_index;
+		return true;
+	}
+
+	static uint64_t getPowerOfTwo(uint64_t value)
+	{
+		uint64_t result = 1;
+		while (result < value) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+private:
+	struct Slot
+	{
+		std::atomic<uint64_t> sequence;
+		T value;
+	};
+
+	const uint64_t capacity;
+	const uint64_t mask;
+	std::unique_ptr<Slot[]> slots;
+	alignas(64) std::atomic<uint64_t> write_index;
+	alignas(64) uint64_t read_index;
+};
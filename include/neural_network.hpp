@@ -42,6 +42,64 @@ struct Layer
 		}
 	}
 
+	// Accumulates the gradients of the last forward pass, values must still be the ones computed from inputs
+	void backward(const std::vector<float>& inputs, const std::vector<float>& output_gradient, std::vector<float>& input_gradient)
+	{
+		const uint64_t neurons_count = bias.size();
+		const uint64_t inputs_count = getWeightsCount();
+		if (bias_gradient.empty()) {
+			weights_gradient.assign(neurons_count, std::vector<float>(inputs_count, 0.0f));
+			bias_gradient.assign(neurons_count, 0.0f);
+		}
+
+		input_gradient.assign(inputs_count, 0.0f);
+		for (uint64_t i(0); i < neurons_count; ++i) {
+			// Derivative of tanh(4x)
+			const float delta = output_gradient[i] * 4.0f * (1.0f - values[i] * values[i]);
+			bias_gradient[i] += delta;
+			for (uint64_t j(0); j < inputs_count; ++j) {
+				weights_gradient[i][j] += delta * inputs[j];
+				input_gradient[j] += delta * weights[i][j];
+			}
+		}
+	}
+
+	// Gradient step averaged over the accumulated samples, gradients are then cleared
+	void descend(float learning_rate, uint64_t samples_count)
+	{
+		const float rate = learning_rate / float(std::max<uint64_t>(1, samples_count));
+		const uint64_t neurons_count = bias_gradient.size();
+		for (uint64_t i(0); i < neurons_count; ++i) {
+			bias[i] -= rate * bias_gradient[i];
+			bias_gradient[i] = 0.0f;
+			for (uint64_t j(0); j < weights_gradient[i].size(); ++j) {
+				weights[i][j] -= rate * weights_gradient[i][j];
+				weights_gradient[i][j] = 0.0f;
+			}
+		}
+	}
+
+	// Several inputs stored one after another, each weights row is loaded once for all of them
+	void processRows(const std::vector<float>& inputs, uint64_t rows_count)
+	{
+		const uint64_t neurons_count = bias.size();
+		const uint64_t inputs_count = getWeightsCount();
+		rows_values.resize(rows_count * neurons_count);
+		for (uint64_t i(0); i < neurons_count; ++i) {
+			const std::vector<float>& neuron_weights = weights[i];
+			for (uint64_t r(0); r < rows_count; ++r) {
+				const float* row = &inputs[r * inputs_count];
+				float result = bias[i];
+				for (uint64_t j(0); j < inputs_count; ++j) {
+					result += neuron_weights[j] * row[j];
+				}
+				rows_values[r * neurons_count + i] = tanh(4.0f * result);
+			}
+		}
+		// The first row is still available for display
+		std::copy(rows_values.begin(), rows_values.begin() + neurons_count, values.begin());
+	}
+
 	void print() const
 	{
 		std::cout << "--- layer ---" << std::endl;
@@ -61,6 +119,10 @@ struct Layer
 	std::vector<std::vector<float>> weights;
 	std::vector<float> values;
 	std::vector<float> bias;
+	std::vector<float> rows_values;
+	// Only allocated when training
+	std::vector<std::vector<float>> weights_gradient;
+	std::vector<float> bias_gradient;
 };
 
 
@@ -109,6 +171,47 @@ struct Network
 		return layers.back().values;
 	}
 
+	// Gradient of the loss with respect to the outputs of the last execute
+	void backward(const std::vector<float>& output_gradient)
+	{
+		std::vector<float> gradient = output_gradient;
+		std::vector<float> input_gradient;
+		for (uint64_t i(layers.size()); i--;) {
+			const std::vector<float>& inputs = i ? layers[i - 1].values : last_input;
+			layers[i].backward(inputs, gradient, input_gradient);
+			gradient.swap(input_gradient);
+		}
+	}
+
+	void descend(float learning_rate, uint64_t samples_count)
+	{
+		for (Layer& layer : layers) {
+			layer.descend(learning_rate, samples_count);
+		}
+	}
+
+	// Sizes the rows buffers up front so that executeRows doesn't allocate
+	void reserveRows(uint64_t rows_count)
+	{
+		for (Layer& layer : layers) {
+			layer.rows_values.resize(rows_count * layer.getNeuronsCount());
+		}
+	}
+
+	// Outputs are stored row after row like the inputs
+	const std::vector<float>& executeRows(const std::vector<float>& inputs, uint64_t rows_count)
+	{
+		if (inputs.size() == input_size * rows_count) {
+			layers.front().processRows(inputs, rows_count);
+			const uint64_t layers_count = layers.size();
+			for (uint64_t i(1); i < layers_count; ++i) {
+				layers[i].processRows(layers[i - 1].rows_values, rows_count);
+			}
+		}
+
+		return layers.back().rows_values;
+	}
+
 	uint64_t getParametersCount() const
 	{
 		uint64_t result = 0;
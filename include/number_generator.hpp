@@ -29,6 +29,12 @@ struct NumberGenerator
 		return (distribution(gen) + 1.0f) * 0.5f * max_value;
 	}
 
+	uint32_t getIntUnder(uint32_t max_value)
+	{
+		std::uniform_int_distribution<uint32_t> int_distribution(0, max_value);
+		return int_distribution(gen);
+	}
+
 	float getMaxRange()
 	{
 		return std::numeric_limits<float>::max() * distribution(gen);
@@ -41,9 +47,26 @@ struct NumberGenerator
 		distribution.reset();
 	}
 
+	void seed(uint32_t value)
+	{
+		gen.seed(value);
+		distribution.reset();
+	}
+
 	static NumberGenerator& getInstance()
 	{
-		return *s_instance;
+		// Threads owning their own stream (islands, workers...) bypass the shared one
+		return t_instance ? *t_instance : *s_instance;
+	}
+
+	static void setThreadInstance(NumberGenerator* generator)
+	{
+		t_instance = generator;
+	}
+
+	static NumberGenerator* getThreadInstance()
+	{
+		return t_instance;
 	}
 
 	static void initialize()
@@ -51,14 +74,25 @@ struct NumberGenerator
 		s_instance = std::make_unique<NumberGenerator>(true);
 	}
 
+	// Reproducible runs, the shared stream starts from seed
+	static void initialize(uint32_t seed)
+	{
+		s_instance = std::make_unique<NumberGenerator>(false);
+		s_instance->seed(seed);
+	}
+
 	std::uniform_real_distribution<float> distribution;
 	std::random_device rd;
 	std::mt19937 gen;
 
 	static std::unique_ptr<NumberGenerator> s_instance;
+	static thread_local NumberGenerator* t_instance;
 };
 
 
 template<typename T>
 std::unique_ptr<NumberGenerator<T>> NumberGenerator<T>::s_instance;
 
+template<typename T>
+thread_local NumberGenerator<T>* NumberGenerator<T>::t_instance = nullptr;
+
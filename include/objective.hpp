@@ -9,6 +9,7 @@ struct Objective
 	float time_in;
 	float time_out;
 	float points;
+	float lifetime;
 
 	Objective()
 	{}
@@ -19,6 +20,7 @@ struct Objective
 		time_in = 0.0f;
 		time_out = 0.0f;
 		points = 0.0f;
+		lifetime = 0.0f;
 	}
 
 	template<typename T>
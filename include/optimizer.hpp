@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+#include "dna.hpp"
+
+
+/*
+	Ask / tell interface for engines replacing the genetic breeding of the Selector.
+	The Selector evaluates the genomes given by ask and sends back their fitness in the same order.
+*/
+struct Optimizer
+{
+	virtual ~Optimizer() = default;
+
+	// Fills the genomes of the next population
+	virtual void ask(std::vector<DNA>& genomes) = 0;
+
+	// Fitness of the genomes returned by the last ask, in the same order
+	virtual void tell(const std::vector<float>& fitness) = 0;
+};
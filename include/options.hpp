@@ -0,0 +1,149 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <sstream>
+#include <iostream>
+
+
+/*
+	Command line options, everything is optional and defaults to the interactive viewer
+*/
+struct Options
+{
+	// Number of islands, 0 means single population
+	uint32_t islands = 0;
+	// Number of evaluation worker processes, 0 means in-process evaluation
+	uint32_t workers = 0;
+	// Generations to run in headless modes, 0 means no limit
+	uint32_t generations = 0;
+	uint32_t seed = 0;
+	// Worker threads per population, 0 means one per physical core (split between islands)
+	uint32_t threads = 0;
+	// Pin workers to cores and move the drones memory next to them
+	bool pin = false;
+	// Benchmark thread counts and update grains, cache the fastest for this host then exit
+	bool tune = false;
+	// Seeded headless training checked against a golden best fitness trajectory, then exit
+	bool macro_benchmark = false;
+	// Defaults to one file per seed
+	std::string golden;
+	float golden_tolerance = 0.0f;
+	// Per phase timings of headless runs, one row per generation (needs AUTODRONE_PROFILING).
+	// With islands, times are summed over all of them
+	std::string profile_csv;
+	// Chrome trace of the worker threads, written at exit, keeping the last events of each thread
+	std::string trace;
+	uint64_t trace_capacity = 1 << 16;
+	// Hardware counters per phase and worker, reported at the end of headless runs
+	bool perf = false;
+	// Allocations per step and generation of headless runs (needs AUTODRONE_ALLOC_TRACKING)
+	bool alloc_report = false;
+	// Abort on any allocation in the allocation free regions (needs AUTODRONE_ALLOC_TRACKING)
+	bool alloc_enforce = false;
+	// Replace finished drones right away instead of breeding whole generations
+	bool steady_state = false;
+	// Retire drones that can't reach the survivors anymore, slack < 1 trades exactness for speed
+	bool pruning = false;
+	float pruning_slack = 1.0f;
+	// Screen children with a short coarse rollout before the full one
+	bool prescreening = false;
+	// Scenarios each genome is evaluated on, and how their fitness is combined (mean, min or quantile)
+	uint32_t scenarios = 1;
+	std::string aggregation = "mean";
+	float quantile = 0.25f;
+	// Same targets every generation, drawn from seed, and reuse of already known fitness
+	bool fixed_scenarios = false;
+	bool fitness_cache = false;
+	// Storage of the genes: fp32, fp16 or bf16
+	std::string genes = "fp32";
+	// Hidden layers of the architectures competing in the population, e.g. 9x9,6x6,4
+	std::string buckets;
+	// One shared network for both thrusters
+	bool mirrored = false;
+	// Breeding engine: ga, cmaes or es
+	std::string optimizer = "ga";
+	// Headless runs stop and report the elapsed time once reached, 0 to disable
+	float target_fitness = 0.0f;
+	// Compare selection with and without pruning then exit
+	bool pruning_check = false;
+	// Compare dense and magnitude pruned networks then exit
+	bool sparse_check = false;
+	float sparse_threshold = 0.1f;
+	// Hidden sizes of a smaller network the champion is distilled into, then exit
+	std::string distill;
+	// Share of the teacher's fitness the student needs to be written
+	float distill_ratio = 0.8f;
+	// Compare float and int8 trajectories of the best drones on --scenarios targets sets then exit
+	bool quantization_check = false;
+
+	Options(int argc, char** argv)
+	{
+		for (int i(1); i < argc; ++i) {
+			const std::string arg = argv[i];
+			const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+			if (readValue(arg, "--islands", value, islands) ||
+				readValue(arg, "--workers", value, workers) ||
+				readValue(arg, "--generations", value, generations) ||
+				readValue(arg, "--seed", value, seed) ||
+				readValue(arg, "--threads", value, threads) ||
+				readValue(arg, "--pruning-slack", value, pruning_slack) ||
+				readValue(arg, "--scenarios", value, scenarios) ||
+				readValue(arg, "--aggregation", value, aggregation) ||
+				readValue(arg, "--quantile", value, quantile) ||
+				readValue(arg, "--optimizer", value, optimizer) ||
+				readValue(arg, "--genes", value, genes) ||
+				readValue(arg, "--buckets", value, buckets) ||
+				readValue(arg, "--distill", value, distill) ||
+				readValue(arg, "--distill-ratio", value, distill_ratio) ||
+				readValue(arg, "--golden", value, golden) ||
+				readValue(arg, "--golden-tolerance", value, golden_tolerance) ||
+				readValue(arg, "--profile-csv", value, profile_csv) ||
+				readValue(arg, "--trace", value, trace) ||
+				readValue(arg, "--trace-capacity", value, trace_capacity) ||
+				readValue(arg, "--target-fitness", value, target_fitness) ||
+				readValue(arg, "--sparse-threshold", value, sparse_threshold)) {
+				++i;
+			}
+			else if (readFlag(arg, "--steady-state", steady_state) ||
+					 readFlag(arg, "--pruning", pruning) ||
+					 readFlag(arg, "--pruning-check", pruning_check) ||
+					 readFlag(arg, "--sparse-check", sparse_check) ||
+					 readFlag(arg, "--quantization-check", quantization_check) ||
+					 readFlag(arg, "--prescreening", prescreening) ||
+					 readFlag(arg, "--fixed-scenarios", fixed_scenarios) ||
+					 readFlag(arg, "--fitness-cache", fitness_cache) ||
+					 readFlag(arg, "--mirrored", mirrored) ||
+					 readFlag(arg, "--pin", pin) ||
+					 readFlag(arg, "--tune", tune) ||
+					 readFlag(arg, "--macro-benchmark", macro_benchmark) ||
+					 readFlag(arg, "--perf", perf) ||
+					 readFlag(arg, "--alloc-report", alloc_report) ||
+					 readFlag(arg, "--alloc-enforce", alloc_enforce)) {
+			}
+			else {
+				std::cout << "Unknown option " << arg << std::endl;
+			}
+		}
+	}
+
+	static bool readFlag(const std::string& arg, const std::string& name, bool& out)
+	{
+		if (arg != name) {
+			return false;
+		}
+		out = true;
+		return true;
+	}
+
+	template<typename T>
+	static bool readValue(const std::string& arg, const std::string& name, const char* value, T& out)
+	{
+		if (arg != name || !value) {
+			return false;
+		}
+		std::stringstream sstr(value);
+		sstr >> out;
+		return true;
+	}
+};
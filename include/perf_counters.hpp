@@ -0,0 +1,335 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <algorithm>
+#include "alloc_tracker.hpp"
+
+#if defined(__linux__)
+	#include <linux/perf_event.h>
+	#include <sys/syscall.h>
+	#include <sys/ioctl.h>
+	#include <unistd.h>
+#endif
+
+
+/*
+	Hardware counters of the calling thread read through perf_event_open, opened as one group so
+	that they are scheduled together. When the kernel refuses (no PMU in a VM, perf_event_paranoid,
+	other OS) every counter reads as unavailable and nothing else changes.
+*/
+namespace perf
+{
+
+enum Counter : uint32_t
+{
+	Cycles,
+	Instructions,
+	CacheMisses,
+	BranchMisses,
+	CountersCount
+};
+
+using Values = std::array<uint64_t, CountersCount>;
+
+inline const char* getName(uint32_t counter)
+{
+	static const char* names[CountersCount] = { "cycles", "instructions", "cache_misses", "branch_misses" };
+	return names[counter];
+}
+
+class ThreadCounters
+{
+public:
+	ThreadCounters()
+	{
+		// Opened on first use, possibly inside an allocation free region
+		ALLOC_PERMIT();
+		m_fds.fill(-1);
+#if defined(__linux__)
+		const uint64_t configs[CountersCount] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+		for (uint32_t i(0); i < CountersCount; ++i) {
+			perf_event_attr attributes;
+			memset(&attributes, 0, sizeof(attributes));
+			attributes.size = sizeof(attributes);
+			attributes.type = PERF_TYPE_HARDWARE;
+			attributes.config = configs[i];
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+			attributes.read_format = PERF_FORMAT_GROUP;
+			attributes.disabled = (m_leader < 0);
+			const int fd = int(syscall(SYS_perf_event_open, &attributes, 0, -1, m_leader, 0));
+			if (fd < 0) {
+				if (m_leader < 0) {
+					m_error = strerror(errno);
+					return;
+				}
+				// Only this counter is missing
+				continue;
+			}
+			m_fds[i] = fd;
+			if (m_leader < 0) {
+				m_leader = fd;
+			}
+		}
+		ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+		m_error = "not supported on this system";
+#endif
+	}
+
+	~ThreadCounters()
+	{
+#if defined(__linux__)
+		for (const int fd : m_fds) {
+			if (fd >= 0) {
+				close(fd);
+			}
+		}
+#endif
+	}
+
+	ThreadCounters(const ThreadCounters&) = delete;
+	ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+	bool isAvailable() const
+	{
+		return m_leader >= 0;
+	}
+
+	bool isAvailable(uint32_t counter) const
+	{
+		return m_fds[counter] >= 0;
+	}
+
+	const std::string& getError() const
+	{
+		return m_error;
+	}
+
+	// Zeros for missing counters
+	Values read() const
+	{
+		Values result{};
+#if defined(__linux__)
+		if (!isAvailable()) {
+			return result;
+		}
+		// Number of counters then their values, in opening order
+		uint64_t buffer[1 + CountersCount];
+		if (::read(m_leader, buffer, sizeof(buffer)) < ssize_t(sizeof(uint64_t))) {
+			return result;
+		}
+		uint64_t k = 1;
+		for (uint32_t i(0); i < CountersCount && k <= buffer[0]; ++i) {
+			if (m_fds[i] >= 0) {
+				result[i] = buffer[k++];
+			}
+		}
+#endif
+		return result;
+	}
+
+	// Counters of the calling thread, opened on first use
+	static ThreadCounters& get()
+	{
+		thread_local ThreadCounters counters;
+		return counters;
+	}
+
+private:
+	std::array<int, CountersCount> m_fds;
+	int m_leader = -1;
+	std::string m_error;
+};
+
+enum class Phase : uint32_t
+{
+	// One measure per update chunk, items are the alive drones of the chunk
+	Update,
+	// Sampled drones only, items are the sampled inferences
+	Inference,
+	// One item per generation
+	Selection,
+	Count
+};
+
+constexpr uint32_t phases_count = uint32_t(Phase::Count);
+
+inline const char* getName(Phase phase)
+{
+	static const char* names[phases_count] = { "update", "inference", "selection" };
+	return names[uint32_t(phase)];
+}
+
+// Totals of a thread, written by its thread only
+struct ThreadTotals
+{
+	std::string name;
+	std::array<Values, phases_count> values{};
+	std::array<uint64_t, phases_count> items{};
+};
+
+/*
+	Collects counters per phase and per thread while enabled. Totals are meant to be read once
+	the measured threads are idle.
+*/
+class Monitor
+{
+public:
+	// One inference in sampling_period is measured, reading counters costs about a microsecond
+	static constexpr uint32_t sampling_period = 64;
+
+	static Monitor& get()
+	{
+		static Monitor monitor;
+		return monitor;
+	}
+
+	// False, with the reason printed, when counters can't be read
+	bool enable()
+	{
+		const ThreadCounters& counters = ThreadCounters::get();
+		if (!counters.isAvailable()) {
+			std::cout << "Perf counters unavailable: " << counters.getError() << std::endl;
+			return false;
+		}
+		m_enabled.store(true, std::memory_order_release);
+		return true;
+	}
+
+	bool isEnabled() const
+	{
+		return m_enabled.load(std::memory_order_relaxed);
+	}
+
+	ThreadTotals& getTotals()
+	{
+		thread_local ThreadTotals* totals = nullptr;
+		if (!totals) {
+			ALLOC_PERMIT();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_totals.push_back(std::make_unique<ThreadTotals>());
+			totals = m_totals.back().get();
+			totals->name = "thread " + std::to_string(m_totals.size() - 1);
+		}
+		return *totals;
+	}
+
+	// Sum over threads
+	ThreadTotals getSum()
+	{
+		ThreadTotals result;
+		result.name = "all";
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const std::unique_ptr<ThreadTotals>& totals : m_totals) {
+			for (uint32_t p(0); p < phases_count; ++p) {
+				for (uint32_t c(0); c < CountersCount; ++c) {
+					result.values[p][c] += totals->values[p][c];
+				}
+				result.items[p] += totals->items[p];
+			}
+		}
+		return result;
+	}
+
+	static void printLine(const ThreadTotals& totals, Phase phase)
+	{
+		const uint32_t p = uint32_t(phase);
+		const Values& values = totals.values[p];
+		const uint64_t items = std::max<uint64_t>(1, totals.items[p]);
+		std::cout << "  " << totals.name << " " << getName(phase) << ": IPC ";
+		if (values[Cycles]) {
+			std::cout << double(values[Instructions]) / double(values[Cycles]);
+		}
+		else {
+			std::cout << "unavailable";
+		}
+		std::cout << ", per item: " << double(values[Cycles]) / double(items) << " cycles, "
+			<< double(values[CacheMisses]) / double(items) << " cache misses, "
+			<< double(values[BranchMisses]) / double(items) << " branch misses (" << totals.items[p] << " items)" << std::endl;
+	}
+
+	// Per phase over all threads then the update phase of each thread
+	void report()
+	{
+		if (!isEnabled()) {
+			std::cout << "Perf counters: unavailable" << std::endl;
+			return;
+		}
+		std::cout << "Perf counters, items are drone steps for update and inference (1 in " << sampling_period << " sampled), generations for selection" << std::endl;
+		const ThreadTotals sum = getSum();
+		for (uint32_t p(0); p < phases_count; ++p) {
+			printLine(sum, Phase(p));
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const std::unique_ptr<ThreadTotals>& totals : m_totals) {
+			if (totals->items[uint32_t(Phase::Update)]) {
+				printLine(*totals, Phase::Update);
+			}
+		}
+	}
+
+private:
+	std::atomic<bool> m_enabled{false};
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<ThreadTotals>> m_totals;
+};
+
+// Adds the counters of its lifetime to the phase, when the monitor is enabled
+class Scope
+{
+public:
+	Scope(Phase phase, uint64_t items = 1)
+		: m_phase(uint32_t(phase))
+		, m_items(items)
+		, m_enabled(Monitor::get().isEnabled())
+	{
+		if (m_enabled) {
+			m_start = ThreadCounters::get().read();
+		}
+	}
+
+	~Scope()
+	{
+		if (!m_enabled) {
+			return;
+		}
+		const Values end = ThreadCounters::get().read();
+		ThreadTotals& totals = Monitor::get().getTotals();
+		for (uint32_t c(0); c < CountersCount; ++c) {
+			totals.values[m_phase][c] += end[c] - m_start[c];
+		}
+		totals.items[m_phase] += m_items;
+	}
+
+	void addItems(uint64_t items)
+	{
+		m_items += items;
+	}
+
+private:
+	uint32_t m_phase;
+	uint64_t m_items;
+	bool m_enabled;
+	Values m_start{};
+};
+
+// True once every sampling_period calls on a thread, only while the monitor is enabled
+inline bool sampleInference()
+{
+	if (!Monitor::get().isEnabled()) {
+		return false;
+	}
+	thread_local uint32_t calls = 0;
+	return !(++calls % Monitor::sampling_period);
+}
+
+}
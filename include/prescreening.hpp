@@ -0,0 +1,140 @@
+#pragma once
+
+#include <vector>
+#include <numeric>
+#include <limits>
+#include <algorithm>
+#include <iostream>
+
+
+/*
+	Two stages evaluation: every offspring first runs a short rollout with a coarse time step,
+	only the best ones are then evaluated with the full rollout. Elites carried over from the
+	previous generation are always promoted, a bad short rollout must not cost them their place.
+	Every audit_frequency generations all units get the full rollout to measure how often the screen is wrong.
+*/
+struct Prescreener
+{
+	uint32_t dt_factor = 4;
+	// Part of the full iteration time used for screening
+	float horizon_ratio = 0.1f;
+	float promoted_ratio = 0.25f;
+	uint32_t audit_frequency = 10;
+
+	std::vector<float> screening_fitness;
+	std::vector<uint8_t> promoted;
+	std::vector<uint32_t> ranking;
+	bool pending = false;
+	bool audit = false;
+	uint32_t screened_count = 0;
+
+	uint64_t screening_steps = 0;
+	// Drone steps of the generations that were not audited
+	uint64_t total_screening_steps = 0;
+	uint64_t total_full_steps = 0;
+	uint64_t audits_count = 0;
+	uint64_t audited_count = 0;
+	uint64_t disagreements_count = 0;
+
+	uint32_t getPromotedCount(uint64_t population_size) const
+	{
+		return std::max(1u, static_cast<uint32_t>(population_size * promoted_ratio));
+	}
+
+	// Ranks units on their screening fitness, indexed by unit index. Units with an index below elites_count are the carried over elites
+	template<typename T>
+	void select(const std::vector<T>& units, uint64_t drone_steps, uint32_t elites_count)
+	{
+		const uint64_t size = units.size();
+		screening_fitness.resize(size);
+		promoted.assign(size, 0);
+		for (const T& u : units) {
+			screening_fitness[u.index] = u.fitness;
+		}
+
+		const uint32_t elites = std::min<uint32_t>(elites_count, uint32_t(size));
+		std::fill(promoted.begin(), promoted.begin() + elites, 1);
+		rank(screening_fitness);
+		// The best offspring on top of the elites
+		const uint32_t promoted_count = getPromotedCount(size - elites);
+		uint32_t count = 0;
+		for (uint32_t i(0); i < size && count < promoted_count; ++i) {
+			if (!promoted[ranking[i]]) {
+				promoted[ranking[i]] = 1;
+				++count;
+			}
+		}
+
+		screening_steps = drone_steps;
+		audit = audit_frequency && !(screened_count % audit_frequency);
+		++screened_count;
+		pending = true;
+	}
+
+	bool isPromoted(uint32_t index) const
+	{
+		return audit || promoted[index];
+	}
+
+	// Gives a fitness to units that were not promoted, must be called once the full rollout is done
+	template<typename T>
+	void finalize(std::vector<T>& units, uint64_t full_steps)
+	{
+		pending = false;
+		if (audit) {
+			reportAudit(units, full_steps);
+			return;
+		}
+		total_screening_steps += screening_steps;
+		total_full_steps += full_steps;
+
+		// Screened out units can't rank above the promoted ones
+		float worst_promoted = std::numeric_limits<float>::max();
+		for (const T& u : units) {
+			if (promoted[u.index]) {
+				worst_promoted = std::min(worst_promoted, u.fitness);
+			}
+		}
+
+		// Proximity reward is gained per step, a full rollout has dt_factor / horizon_ratio times more
+		const float scale = float(dt_factor) / horizon_ratio;
+		for (T& u : units) {
+			if (!promoted[u.index]) {
+				u.fitness = std::min(worst_promoted, scale * screening_fitness[u.index]);
+			}
+		}
+	}
+
+	template<typename T>
+	void reportAudit(const std::vector<T>& units, uint64_t full_steps)
+	{
+		std::vector<float> full_fitness(units.size());
+		for (const T& u : units) {
+			full_fitness[u.index] = u.fitness;
+		}
+
+		rank(full_fitness);
+		const uint32_t promoted_count = getPromotedCount(units.size());
+		uint32_t missed = 0;
+		for (uint32_t i(0); i < promoted_count; ++i) {
+			missed += !promoted[ranking[i]];
+		}
+
+		++audits_count;
+		audited_count += promoted_count;
+		disagreements_count += missed;
+		std::cout << "Prescreening audit: " << missed << "/" << promoted_count << " of the full top were screened out ("
+			<< (100.0f * disagreements_count / audited_count) << "% over " << audits_count << " audits)" << std::endl;
+		std::cout << "  Drone steps with everyone promoted " << (screening_steps + full_steps)
+			<< ", screened generations total " << (total_screening_steps + total_full_steps)
+			<< " (screening " << total_screening_steps << ")" << std::endl;
+	}
+
+private:
+	void rank(const std::vector<float>& fitness)
+	{
+		ranking.resize(fitness.size());
+		std::iota(ranking.begin(), ranking.end(), 0u);
+		std::sort(ranking.begin(), ranking.end(), [&](uint32_t a, uint32_t b) { return fitness[a] > fitness[b]; });
+	}
+};
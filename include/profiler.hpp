@@ -0,0 +1,240 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include "alloc_tracker.hpp"
+
+
+/*
+	Wall time per simulation phase. Scoped timers add to slots owned by their thread, the slots
+	are summed once per frame or generation and the differences kept in a ring of samples.
+	Phases of a single drone step are too short to time each one: only one step out of
+	sampling_period per thread is timed, and counted sampling_period times.
+	Timers only exist in builds with AUTODRONE_PROFILING, PROFILE_SCOPE expands to nothing otherwise.
+*/
+namespace profiler
+{
+
+enum class Phase : uint32_t
+{
+	Inference,
+	Physics,
+	Fitness,
+	AliveScan,
+	Selection,
+	NetworkBinding,
+	Rendering,
+	Events,
+	Count
+};
+
+constexpr uint32_t phases_count = uint32_t(Phase::Count);
+
+#if defined(AUTODRONE_PROFILING)
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+inline const char* getName(uint32_t phase)
+{
+	static const char* names[phases_count] = { "inference", "physics", "fitness", "alive_scan", "selection", "network_binding", "rendering", "events" };
+	return names[phase];
+}
+
+// Written by its thread only, read by the collector
+struct ThreadSlot
+{
+	std::array<std::atomic<uint64_t>, phases_count> nanoseconds{};
+};
+
+class Registry
+{
+public:
+	static Registry& get()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	ThreadSlot& getSlot()
+	{
+		thread_local ThreadSlot* slot = nullptr;
+		if (!slot) {
+			// Slots outlive their thread so that their time is still counted
+			ALLOC_PERMIT();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_slots.push_back(std::make_unique<ThreadSlot>());
+			slot = m_slots.back().get();
+		}
+		return *slot;
+	}
+
+	std::array<uint64_t, phases_count> getTotals()
+	{
+		std::array<uint64_t, phases_count> result{};
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const std::unique_ptr<ThreadSlot>& slot : m_slots) {
+			for (uint32_t i(0); i < phases_count; ++i) {
+				result[i] += slot->nanoseconds[i].load(std::memory_order_relaxed);
+			}
+		}
+		return result;
+	}
+
+private:
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<ThreadSlot>> m_slots;
+};
+
+class ScopedTimer
+{
+public:
+	ScopedTimer(Phase phase)
+		: m_slot(Registry::get().getSlot().nanoseconds[uint32_t(phase)])
+		, m_start(std::chrono::steady_clock::now())
+	{}
+
+	~ScopedTimer()
+	{
+		const uint64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+		// Single writer, no need for an atomic add
+		m_slot.store(m_slot.load(std::memory_order_relaxed) + duration, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t>& m_slot;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+constexpr uint32_t sampling_period = 16;
+
+// True once every sampling_period calls on a thread
+inline bool sampleStep()
+{
+	thread_local uint32_t calls = 0;
+	return !(++calls % sampling_period);
+}
+
+// Times its lifetime only when sampled, as sampling_period times the duration
+class SampledTimer
+{
+public:
+	SampledTimer(Phase phase, bool sampled)
+		: m_slot(sampled ? &Registry::get().getSlot().nanoseconds[uint32_t(phase)] : nullptr)
+	{
+		if (m_slot) {
+			m_start = std::chrono::steady_clock::now();
+		}
+	}
+
+	~SampledTimer()
+	{
+		if (m_slot) {
+			const uint64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+			m_slot->store(m_slot->load(std::memory_order_relaxed) + duration * sampling_period, std::memory_order_relaxed);
+		}
+	}
+
+private:
+	std::atomic<uint64_t>* m_slot;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// Milliseconds spent in each phase, summed over threads, between two collections
+struct Sample
+{
+	std::array<float, phases_count> milliseconds{};
+};
+
+class History
+{
+public:
+	History(uint64_t capacity = 120)
+		: m_samples(capacity)
+		, m_next(0)
+		, m_count(0)
+		, m_last_totals(Registry::get().getTotals())
+	{}
+
+	const Sample& collect()
+	{
+		const std::array<uint64_t, phases_count> totals = Registry::get().getTotals();
+		Sample& sample = m_samples[m_next];
+		for (uint32_t i(0); i < phases_count; ++i) {
+			sample.milliseconds[i] = float(totals[i] - m_last_totals[i]) * 1e-6f;
+		}
+		m_last_totals = totals;
+		m_next = (m_next + 1) % m_samples.size();
+		m_count = std::min<uint64_t>(m_count + 1, m_samples.size());
+		return sample;
+	}
+
+	// Over the kept samples, steadier than the last one for display
+	Sample getAverage() const
+	{
+		Sample result;
+		for (uint64_t s(0); s < m_count; ++s) {
+			for (uint32_t i(0); i < phases_count; ++i) {
+				result.milliseconds[i] += m_samples[s].milliseconds[i] / float(m_count);
+			}
+		}
+		return result;
+	}
+
+private:
+	std::vector<Sample> m_samples;
+	uint64_t m_next;
+	uint64_t m_count;
+	std::array<uint64_t, phases_count> m_last_totals;
+};
+
+// One row per sample, the index is the frame or the generation
+class CsvExport
+{
+public:
+	CsvExport(const std::string& filename, const std::string& index_name = "index")
+		: m_file(filename)
+	{
+		m_file << index_name;
+		for (uint32_t i(0); i < phases_count; ++i) {
+			m_file << "," << getName(i) << "_ms";
+		}
+		m_file << std::endl;
+	}
+
+	void write(uint64_t index, const Sample& sample)
+	{
+		m_file << index;
+		for (const float milliseconds : sample.milliseconds) {
+			m_file << "," << milliseconds;
+		}
+		m_file << std::endl;
+	}
+
+private:
+	std::ofstream m_file;
+};
+
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if defined(AUTODRONE_PROFILING)
+	#define PROFILE_SCOPE(phase) const profiler::ScopedTimer PROFILE_CONCAT(profile_timer_, __LINE__)(profiler::Phase::phase)
+	// Decides once for the following sampled scopes of the same block
+	#define PROFILE_SAMPLE() const bool profile_sampled = profiler::sampleStep()
+	#define PROFILE_SAMPLED_SCOPE(phase) const profiler::SampledTimer PROFILE_CONCAT(profile_timer_, __LINE__)(profiler::Phase::phase, profile_sampled)
+#else
+	#define PROFILE_SCOPE(phase)
+	#define PROFILE_SAMPLE()
+	#define PROFILE_SAMPLED_SCOPE(phase)
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "stadium.hpp"
+
+
+/*
+	Evaluates the same genomes on the same targets with and without pruning
+	and checks that the units kept by the selection are the same.
+*/
+struct PruningCheck
+{
+	struct Result
+	{
+		std::vector<std::pair<float, uint32_t>> survivors;
+		uint64_t drone_steps;
+		uint64_t pruned_count;
+		uint64_t saved_steps;
+	};
+
+	static bool run(Stadium& stadium, float dt, uint32_t seed)
+	{
+		std::vector<DNA> genomes;
+		for (const Drone& d : stadium.selector.getCurrentPopulation()) {
+			genomes.push_back(d.dna);
+		}
+
+		const bool pruning = stadium.pruning;
+		const Result reference = evaluate(stadium, genomes, dt, seed, false);
+		const Result pruned    = evaluate(stadium, genomes, dt, seed, true);
+		stadium.pruning = pruning;
+
+		const bool same_selection = reference.survivors == pruned.survivors;
+		std::cout << "Pruning check: " << (same_selection ? "selection unchanged" : "SELECTION CHANGED") << std::endl;
+		std::cout << "  Drone steps without pruning " << reference.drone_steps << ", with pruning " << pruned.drone_steps << std::endl;
+		std::cout << "  Pruned drones " << pruned.pruned_count << ", estimated steps saved " << pruned.saved_steps << std::endl;
+		return same_selection;
+	}
+
+	static Result evaluate(Stadium& stadium, const std::vector<DNA>& genomes, float dt, uint32_t seed, bool pruning)
+	{
+		std::vector<Drone>& drones = stadium.selector.getCurrentPopulation();
+		for (uint64_t i(0); i < genomes.size(); ++i) {
+			drones[i].loadDNA(genomes[i]);
+		}
+
+		stadium.pruning = pruning;
+		stadium.pruner.resetStats();
+		stadium.setTargetsSeed(seed);
+		stadium.evaluatePopulation(dt);
+
+		Result result;
+		for (const Drone& d : drones) {
+			result.survivors.emplace_back(d.fitness, d.index);
+		}
+		std::sort(result.survivors.begin(), result.survivors.end(), [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) {
+			return a.first > b.first || (a.first == b.first && a.second < b.second);
+		});
+		result.survivors.resize(std::min<uint64_t>(stadium.selector.survivings_count, result.survivors.size()));
+		result.drone_steps  = stadium.current_iteration.drone_steps;
+		result.pruned_count = stadium.pruner.pruned_count;
+		result.saved_steps  = stadium.pruner.saved_steps;
+		return result;
+	}
+};
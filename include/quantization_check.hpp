@@ -0,0 +1,154 @@
+#pragma once
+
+#include <chrono>
+#include "stadium.hpp"
+#include "quantized_network.hpp"
+
+
+/*
+	Flies the same champions with float and int8 networks on a fixed set of scenarios
+	and measures how far the quantized trajectories drift from the float ones.
+*/
+struct QuantizationCheck
+{
+	// Positions of every drone at every step, NaN once dead
+	using Trajectories = std::vector<std::vector<sf::Vector2f>>;
+
+	struct Run
+	{
+		Trajectories trajectories;
+		std::vector<float> fitness;
+	};
+
+	static std::vector<DNA> getChampions(Stadium& stadium, uint32_t count)
+	{
+		std::vector<Drone> population = stadium.selector.getCurrentPopulation();
+		std::sort(population.begin(), population.end(), [](const Drone& a, const Drone& b) { return a.fitness > b.fitness; });
+		std::vector<DNA> result;
+		for (uint64_t i(0); i < std::min<uint64_t>(count, population.size()); ++i) {
+			result.push_back(population[i].dna);
+		}
+		return result;
+	}
+
+	static void run(const std::vector<DNA>& champions, sf::Vector2f area_size, float dt, uint32_t seed, uint32_t scenarios_count)
+	{
+		const uint32_t count = as<uint32_t>(champions.size());
+		Stadium stadium(count, area_size, 1);
+
+		// Distance at which a trajectory is considered to have diverged
+		const float divergence_distance = 10.0f;
+		float fitness_delta = 0.0f;
+		float mean_error = 0.0f;
+		float max_error = 0.0f;
+		float divergence_time = 0.0f;
+		uint32_t diverged_count = 0;
+		uint32_t fate_changes = 0;
+
+		for (uint32_t k(0); k < scenarios_count; ++k) {
+			const Run reference = fly(stadium, champions, dt, seed + k, false);
+			const Run quantized = fly(stadium, champions, dt, seed + k, true);
+
+			for (uint32_t d(0); d < count; ++d) {
+				fitness_delta += std::abs(reference.fitness[d] - quantized.fitness[d]);
+				float error_sum = 0.0f;
+				uint64_t compared_steps = 0;
+				bool diverged = false;
+				const uint64_t steps_count = std::min(reference.trajectories.size(), quantized.trajectories.size());
+				for (uint64_t s(0); s < steps_count; ++s) {
+					const sf::Vector2f p1 = reference.trajectories[s][d];
+					const sf::Vector2f p2 = quantized.trajectories[s][d];
+					if (std::isnan(p1.x) != std::isnan(p2.x)) {
+						++fate_changes;
+						break;
+					}
+					if (std::isnan(p1.x)) {
+						break;
+					}
+					const float error = getLength(p1 - p2);
+					error_sum += error;
+					max_error = std::max(max_error, error);
+					++compared_steps;
+					if (!diverged && error > divergence_distance) {
+						diverged = true;
+						++diverged_count;
+						divergence_time += float(s) * dt;
+					}
+				}
+				mean_error += compared_steps ? error_sum / float(compared_steps) : 0.0f;
+			}
+		}
+
+		const float runs_count = float(count * scenarios_count);
+		std::cout << "Quantization check, " << count << " champions on " << scenarios_count << " scenarios, " << QuantizedNetwork::getKernelName() << " kernel" << std::endl;
+		std::cout << "  Mean absolute fitness delta " << fitness_delta / runs_count << std::endl;
+		std::cout << "  Position error mean " << mean_error / runs_count << ", max " << max_error << std::endl;
+		std::cout << "  Diverged by more than " << divergence_distance << " in " << diverged_count << " runs";
+		if (diverged_count) {
+			std::cout << ", after " << divergence_time / float(diverged_count) << " s on average";
+		}
+		std::cout << ", " << fate_changes << " crashed in only one version" << std::endl;
+		benchmarkKernels(champions.front());
+	}
+
+	static Run fly(Stadium& stadium, const std::vector<DNA>& champions, float dt, uint32_t seed, bool quantized)
+	{
+		std::vector<Drone>& drones = stadium.selector.getCurrentPopulation();
+		for (uint64_t i(0); i < champions.size(); ++i) {
+			drones[i].quantized = quantized;
+			drones[i].loadGenome(champions[i]);
+		}
+
+		stadium.setTargetsSeed(seed);
+		stadium.initializeTargets();
+		stadium.initializeDrones();
+		stadium.current_iteration.reset();
+
+		Run result;
+		const float dead = std::numeric_limits<float>::quiet_NaN();
+		while (stadium.getAliveCount() && stadium.current_iteration.time <= stadium.max_iteration_time) {
+			stadium.update(dt, false);
+			result.trajectories.emplace_back();
+			for (const Drone& d : drones) {
+				result.trajectories.back().push_back(d.alive ? d.position : sf::Vector2f(dead, dead));
+			}
+		}
+		for (const Drone& d : drones) {
+			result.fitness.push_back(d.fitness);
+		}
+		return result;
+	}
+
+	static void benchmarkKernels(const DNA& dna)
+	{
+		Drone drone;
+		drone.loadGenome(dna);
+		Network dense = drone.network;
+		QuantizedNetwork quantized(dense);
+
+		const uint64_t rounds = 200000;
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+		std::vector<float> input(dense.input_size);
+		float checksum = 0.0f;
+
+		float durations[2];
+		for (uint32_t version(0); version < 2; ++version) {
+			const auto start = std::chrono::steady_clock::now();
+			for (uint64_t r(0); r < rounds; ++r) {
+				input[r % input.size()] = distribution(generator);
+				checksum += version ? quantized.execute(input)[0] : dense.execute(input)[0];
+			}
+			durations[version] = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		uint64_t float_bytes = 0;
+		for (const Layer& layer : dense.layers) {
+			float_bytes += layer.getNeuronsCount() * layer.getWeightsCount() * sizeof(float);
+		}
+		std::cout << "  Weight bytes " << float_bytes << " float, " << quantized.getWeightBytes() << " int8 (rows padded to " << QuantizedLayer::lane << "), "
+			<< double(float_bytes) / double(quantized.getWeightBytes()) << "x smaller" << std::endl;
+		std::cout << "  Inference speedup " << durations[0] / durations[1] << "x" << std::endl;
+		doNotOptimize(checksum);
+	}
+};
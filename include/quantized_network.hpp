@@ -0,0 +1,196 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "neural_network.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+	#include <immintrin.h>
+#endif
+
+
+/*
+	Post training int8 version of a Layer, weights share one scale per layer.
+	Inputs are quantized on the fly with their own scale and products are accumulated in int32.
+	Rows are padded with zeros to a multiple of 16 so the SIMD kernel has no tail. The default
+	layers have 7 to 9 inputs per row, so weights take about half the float bytes, not a quarter.
+*/
+struct QuantizedLayer
+{
+	static constexpr uint64_t lane = 16;
+
+	QuantizedLayer(const Layer& layer)
+		: inputs_count(layer.getWeightsCount())
+		, stride((inputs_count + lane - 1) / lane * lane)
+		, weights(layer.getNeuronsCount() * stride, 0)
+		, weight_scale(1.0f)
+		, bias(layer.bias)
+		, values(layer.getNeuronsCount())
+		, quantized_inputs(stride, 0)
+	{
+		float max_weight = 0.0f;
+		for (const std::vector<float>& row : layer.weights) {
+			for (const float w : row) {
+				max_weight = std::max(max_weight, std::abs(w));
+			}
+		}
+		if (max_weight > 0.0f) {
+			weight_scale = max_weight / 127.0f;
+		}
+
+		const uint64_t neurons_count = layer.getNeuronsCount();
+		for (uint64_t i(0); i < neurons_count; ++i) {
+			for (uint64_t j(0); j < inputs_count; ++j) {
+				weights[i * stride + j] = quantize(layer.weights[i][j], weight_scale);
+			}
+		}
+	}
+
+	void process(const std::vector<float>& inputs)
+	{
+		float max_input = 0.0f;
+		for (uint64_t j(0); j < inputs_count; ++j) {
+			max_input = std::max(max_input, std::abs(inputs[j]));
+		}
+		const float input_scale = max_input > 0.0f ? max_input / 127.0f : 1.0f;
+		for (uint64_t j(0); j < inputs_count; ++j) {
+			quantized_inputs[j] = quantize(inputs[j], input_scale);
+		}
+
+		const float scale = weight_scale * input_scale;
+		const uint64_t neurons_count = bias.size();
+		for (uint64_t i(0); i < neurons_count; ++i) {
+			const int32_t accumulator = dot(&weights[i * stride], quantized_inputs.data(), stride);
+			values[i] = approxTanh(4.0f * (bias[i] + float(accumulator) * scale));
+		}
+	}
+
+	uint64_t getWeightBytes() const
+	{
+		return weights.size() * sizeof(int8_t);
+	}
+
+	static int8_t quantize(float value, float scale)
+	{
+		const float q = std::round(value / scale);
+		return static_cast<int8_t>(std::max(-127.0f, std::min(127.0f, q)));
+	}
+
+	// Rational approximation, exact at 0 and reaches +-1 at +-3
+	static float approxTanh(float x)
+	{
+		x = std::max(-3.0f, std::min(3.0f, x));
+		const float x2 = x * x;
+		return x * (27.0f + x2) / (27.0f + 9.0f * x2);
+	}
+
+	static int32_t dotScalar(const int8_t* a, const int8_t* b, uint64_t size)
+	{
+		int32_t result = 0;
+		for (uint64_t k(0); k < size; ++k) {
+			result += int32_t(a[k]) * int32_t(b[k]);
+		}
+		return result;
+	}
+
+	// Bytes are widened to int16 then multiplied and pairwise added by madd, nothing can saturate
+	static int32_t dot(const int8_t* a, const int8_t* b, uint64_t size)
+	{
+#if defined(__AVX2__)
+		__m256i sum = _mm256_setzero_si256();
+		for (uint64_t k(0); k < size; k += lane) {
+			const __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + k)));
+			const __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + k)));
+			sum = _mm256_add_epi32(sum, _mm256_madd_epi16(va, vb));
+		}
+		return horizontalSum(_mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)));
+#elif defined(__SSE2__) || defined(_M_X64)
+		__m128i sum = _mm_setzero_si128();
+		for (uint64_t k(0); k < size; k += lane) {
+			const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + k));
+			const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + k));
+			// Sign extension, each byte is duplicated in a 16 bits word then shifted back
+			const __m128i a_low  = _mm_srai_epi16(_mm_unpacklo_epi8(va, va), 8);
+			const __m128i a_high = _mm_srai_epi16(_mm_unpackhi_epi8(va, va), 8);
+			const __m128i b_low  = _mm_srai_epi16(_mm_unpacklo_epi8(vb, vb), 8);
+			const __m128i b_high = _mm_srai_epi16(_mm_unpackhi_epi8(vb, vb), 8);
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(a_low, b_low));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(a_high, b_high));
+		}
+		return horizontalSum(sum);
+#else
+		return dotScalar(a, b, size);
+#endif
+	}
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+	static int32_t horizontalSum(__m128i v)
+	{
+		v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+		v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+		return _mm_cvtsi128_si32(v);
+	}
+#endif
+
+	uint64_t inputs_count;
+	uint64_t stride;
+	std::vector<int8_t> weights;
+	float weight_scale;
+	std::vector<float> bias;
+	std::vector<float> values;
+	std::vector<int8_t> quantized_inputs;
+};
+
+
+struct QuantizedNetwork
+{
+	QuantizedNetwork()
+		: input_size(0)
+	{}
+
+	QuantizedNetwork(const Network& network)
+		: input_size(network.input_size)
+	{
+		for (const Layer& layer : network.layers) {
+			layers.emplace_back(layer);
+		}
+	}
+
+	const std::vector<float>& execute(const std::vector<float>& input)
+	{
+		if (input.size() == input_size) {
+			layers.front().process(input);
+			const uint64_t layers_count = layers.size();
+			for (uint64_t i(1); i < layers_count; ++i) {
+				layers[i].process(layers[i - 1].values);
+			}
+		}
+
+		return layers.back().values;
+	}
+
+	uint64_t getWeightBytes() const
+	{
+		uint64_t result = 0;
+		for (const QuantizedLayer& layer : layers) {
+			result += layer.getWeightBytes();
+		}
+		return result;
+	}
+
+	static const char* getKernelName()
+	{
+#if defined(__AVX2__)
+		return "avx2";
+#elif defined(__SSE2__) || defined(_M_X64)
+		return "sse2";
+#else
+		return "scalar";
+#endif
+	}
+
+	uint64_t input_size;
+	std::vector<QuantizedLayer> layers;
+};
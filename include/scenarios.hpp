@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+
+enum class FitnessAggregation
+{
+	Mean,
+	Min,
+	Quantile
+};
+
+
+/*
+	Combines the fitness a genome got on each scenario into a single score
+*/
+struct ScenarioAggregator
+{
+	FitnessAggregation mode = FitnessAggregation::Mean;
+	// Used by Quantile, 0 is the worst scenario and 1 the best
+	float quantile = 0.25f;
+	std::vector<float> samples;
+
+	float aggregate()
+	{
+		if (samples.empty()) {
+			return 0.0f;
+		}
+
+		switch (mode) {
+		case FitnessAggregation::Min:
+			return *std::min_element(samples.begin(), samples.end());
+		case FitnessAggregation::Quantile:
+		{
+			const uint64_t rank = static_cast<uint64_t>(quantile * (samples.size() - 1) + 0.5f);
+			std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+			return samples[rank];
+		}
+		default:
+			return std::accumulate(samples.begin(), samples.end(), 0.0f) / float(samples.size());
+		}
+	}
+};
@@ -5,8 +5,11 @@
 #include "unit.hpp"
 #include "double_buffer.hpp"
 #include <fstream>
+#include <limits>
 #include <sstream>
+#include <swarm.hpp>
 #include "dna_loader.hpp"
+#include "optimizer.hpp"
 
 
 const float population_elite_ratio = 0.05f;
@@ -23,7 +26,24 @@ struct Selector
 	SelectionWheel wheel;
 	std::string out_file;
 	uint32_t dump_frequency = 10;
+	// When set, dumps are written by its workers so generations don't wait for the disk
+	swrm::Swarm* dump_swarm = nullptr;
+	swrm::Future<void> last_dump;
+	// When set, offspring are bred by its workers, see startNextGeneration
+	swrm::Swarm* breed_swarm = nullptr;
+	static constexpr uint32_t breeding_chunk = 32;
+	struct Mating
+	{
+		const T* parent_1;
+		const T* parent_2;
+		uint32_t seed;
+	};
+	std::vector<Mating> matings;
+	std::vector<swrm::Future<void>> breeding;
 	uint32_t generation;
+	// When set, breeding is replaced by this engine
+	std::unique_ptr<Optimizer> optimizer;
+	bool optimizer_asked = false;
 
 	Selector(const uint32_t agents_count)
 		: population(agents_count)
@@ -51,8 +71,42 @@ struct Selector
 		std::cout << "Writing dumps in " << filename << std::endl;
 	}
 
+	// Each dump depends on the previous one so the file is appended in order
+	void dump(const DNA& dna)
+	{
+		if (!dump_swarm) {
+			const swrm::TraceScope trace("io_flush");
+			DnaLoader::writeDnaToFile(out_file, dna);
+			return;
+		}
+		std::vector<swrm::TaskPtr> previous;
+		if (last_dump.valid()) {
+			previous.push_back(last_dump.getTask());
+		}
+		last_dump = dump_swarm->after(previous, [file = out_file, dna]() {
+			const swrm::TraceScope trace("io_flush");
+			DnaLoader::writeDnaToFile(file, dna);
+		});
+	}
+
 	void nextGeneration()
 	{
+		startNextGeneration();
+		waitBreeding();
+	}
+
+	/*
+		Parents are picked here, offspring are then bred by breed_swarm tasks while the caller goes on.
+		The new population can only be used after waitBreeding. Each child draws from its own stream,
+		seeded from the selector's one, so the result doesn't depend on the threads count.
+	*/
+	void startNextGeneration()
+	{
+		waitBreeding();
+		if (optimizer) {
+			// Before sorting, fitness has to be in the order genomes were asked
+			tellOptimizer();
+		}
 		// Create selection wheel
 		sortCurrentPopulation();
 		std::vector<T>& current_units = population.getCurrent();
@@ -60,31 +114,136 @@ struct Selector
 		wheel.addFitnessScores(current_units);
 		// Replace the weakest
 		std::cout << "Gen: " << generation << " Best: " << current_units[0].fitness << std::endl;
+		printBuckets(current_units);
 		if ((generation%dump_frequency) == 0) {
-			DnaLoader::writeDnaToFile(out_file, getCurrentPopulation()[0].dna);
+			dump(getCurrentPopulation()[0].dna);
+		}
+
+		if (optimizer) {
+			askOptimizer(next_units);
+			switchPopulation();
+			return;
 		}
 
+		// Nothing was evaluated yet, breeding from zero fitness would keep a single random parent (and bucket)
+		const uint32_t kept_count = wheel.fitness_acc.back() > 0.0f ? elites_count : population_size;
 		// The top best survive;
-		uint32_t evolve_count = 0;
-		for (uint32_t i(0); i < elites_count; ++i) {
+		for (uint32_t i(0); i < kept_count; ++i) {
 			next_units[i] = current_units[i];
 		}
-		for (uint32_t i(elites_count); i < population_size; ++i) {
-			const T& unit_1 = wheel.pick(current_units);
-			const T& unit_2 = wheel.pick(current_units);
-			const float mutation_proba = 1.0f / sqrt(unit_1.fitness + unit_2.fitness);
-			if (unit_1.dna == unit_2.dna) {
-				++evolve_count;
-				next_units[i].loadDNA(DNAUtils::evolve<float>(unit_1.dna, mutation_proba, mutation_proba));
-			}
-			else {
-				next_units[i].loadDNA(DNAUtils::makeChild<float>(unit_1.dna, unit_2.dna, mutation_proba));
+		if (!breed_swarm) {
+			for (uint32_t i(kept_count); i < population_size; ++i) {
+				const T& unit_1 = wheel.pick(current_units);
+				const T& unit_2 = pickMate(unit_1, current_units);
+				breed(unit_1, unit_2, next_units[i]);
 			}
 		}
+		else {
+			breedTail(kept_count, current_units, next_units);
+		}
 
 		switchPopulation();
 	}
 
+	void waitBreeding()
+	{
+		for (swrm::Future<void>& task : breeding) {
+			task.get();
+		}
+		breeding.clear();
+	}
+
+	static void breed(const T& unit_1, const T& unit_2, T& child)
+	{
+		child.setBucket(unit_1.bucket);
+		// Written over the genome the slot already holds
+		DNAUtils::breed(unit_1.dna, unit_1.fitness, unit_2.dna, unit_2.fitness, child.dna);
+		child.reloadDNA();
+	}
+
+	// Offspring from first on, in chunks of breeding_chunk children per task
+	void breedTail(uint32_t first, const std::vector<T>& parents, std::vector<T>& children)
+	{
+		matings.resize(population_size);
+		for (uint32_t i(first); i < population_size; ++i) {
+			const T& unit_1 = wheel.pick(parents);
+			const T& unit_2 = pickMate(unit_1, parents);
+			matings[i] = { &unit_1, &unit_2, NumberGenerator<>::getInstance().getIntUnder(std::numeric_limits<uint32_t>::max()) };
+		}
+		for (uint32_t start(first); start < population_size; start += breeding_chunk) {
+			const uint32_t end = std::min(population_size, start + breeding_chunk);
+			breeding.push_back(breed_swarm->async([this, &children, start, end] {
+				// One stream per thread, reseeded for each child
+				thread_local NumberGenerator<> generator(false);
+				NumberGenerator<>* previous = NumberGenerator<>::getThreadInstance();
+				NumberGenerator<>::setThreadInstance(&generator);
+				for (uint32_t i(start); i < end; ++i) {
+					generator.seed(matings[i].seed);
+					breed(*matings[i].parent_1, *matings[i].parent_2, children[i]);
+				}
+				NumberGenerator<>::setThreadInstance(previous);
+			}));
+		}
+	}
+
+	// Crossover only happens inside a bucket, a unit without mate is mutated instead
+	const T& pickMate(const T& unit, const std::vector<T>& units)
+	{
+		const uint32_t max_tries = 16;
+		for (uint32_t i(0); i < max_tries; ++i) {
+			const T& mate = wheel.pick(units);
+			if (mate.bucket == unit.bucket) {
+				return mate;
+			}
+		}
+		return unit;
+	}
+
+	// Size and best fitness of each bucket, units have to be sorted
+	void printBuckets(const std::vector<T>& units) const
+	{
+		std::vector<uint32_t> counts;
+		std::vector<float> best;
+		for (const T& unit : units) {
+			if (unit.bucket >= counts.size()) {
+				counts.resize(unit.bucket + 1, 0);
+				best.resize(unit.bucket + 1, 0.0f);
+			}
+			if (!counts[unit.bucket]++) {
+				best[unit.bucket] = unit.fitness;
+			}
+		}
+		if (counts.size() < 2) {
+			return;
+		}
+		for (uint64_t i(0); i < counts.size(); ++i) {
+			std::cout << "  Bucket " << i << ": " << counts[i] << " units, best " << best[i] << std::endl;
+		}
+	}
+
+	void tellOptimizer()
+	{
+		// The first population was not given by the optimizer
+		if (!optimizer_asked) {
+			return;
+		}
+		std::vector<float> fitness;
+		for (const T& unit : population.getCurrent()) {
+			fitness.push_back(unit.fitness);
+		}
+		optimizer->tell(fitness);
+	}
+
+	void askOptimizer(std::vector<T>& units)
+	{
+		std::vector<DNA> genomes(units.size(), DNA(units.front().dna.getBytesCount() * 8));
+		optimizer->ask(genomes);
+		for (uint64_t i(0); i < units.size(); ++i) {
+			units[i].loadDNA(genomes[i]);
+		}
+		optimizer_asked = true;
+	}
+
 	void sortCurrentPopulation()
 	{
 		std::vector<T>& current_units = population.getCurrent();
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include "stadium.hpp"
+#include "sparse_network.hpp"
+
+
+/*
+	Replays the same genomes on the same targets with dense and magnitude pruned networks,
+	reports the fitness lost and the speed of both kernels.
+*/
+struct SparseCheck
+{
+	struct Result
+	{
+		std::vector<float> fitness;
+		float duration;
+	};
+
+	static void run(Stadium& stadium, float dt, uint32_t seed, float threshold)
+	{
+		std::vector<DNA> genomes;
+		for (const Drone& d : stadium.selector.getCurrentPopulation()) {
+			genomes.push_back(d.dna);
+		}
+
+		const Result dense  = evaluate(stadium, genomes, dt, seed, 0.0f);
+		const Result sparse = evaluate(stadium, genomes, dt, seed, threshold);
+
+		float dense_sum = 0.0f;
+		float sparse_sum = 0.0f;
+		float delta_sum = 0.0f;
+		uint64_t best = 0;
+		for (uint64_t i(0); i < genomes.size(); ++i) {
+			dense_sum  += dense.fitness[i];
+			sparse_sum += sparse.fitness[i];
+			delta_sum  += std::abs(dense.fitness[i] - sparse.fitness[i]);
+			if (dense.fitness[i] > dense.fitness[best]) {
+				best = i;
+			}
+		}
+		const float count = float(genomes.size());
+
+		Drone champion;
+		champion.loadGenome(genomes[best]);
+		const SparseNetwork champion_sparse(champion.network, threshold);
+
+		std::cout << "Sparse check, threshold " << threshold << std::endl;
+		std::cout << "  Champion density " << champion_sparse.getDensity() << ", fitness dense " << dense.fitness[best] << " sparse " << sparse.fitness[best] << std::endl;
+		std::cout << "  Mean fitness dense " << dense_sum / count << " sparse " << sparse_sum / count << ", mean absolute delta " << delta_sum / count << std::endl;
+		std::cout << "  Population evaluation " << dense.duration << " s dense, " << sparse.duration << " s sparse" << std::endl;
+		benchmarkKernels(champion.network, champion_sparse);
+	}
+
+	static Result evaluate(Stadium& stadium, const std::vector<DNA>& genomes, float dt, uint32_t seed, float threshold)
+	{
+		std::vector<Drone>& drones = stadium.selector.getCurrentPopulation();
+		for (uint64_t i(0); i < genomes.size(); ++i) {
+			drones[i].sparse_threshold = threshold;
+			drones[i].loadDNA(genomes[i]);
+		}
+
+		stadium.setTargetsSeed(seed);
+		const auto start = std::chrono::steady_clock::now();
+		stadium.evaluatePopulation(dt);
+
+		Result result;
+		result.duration = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+		for (const Drone& d : drones) {
+			result.fitness.push_back(d.fitness);
+		}
+		return result;
+	}
+
+	static void benchmarkKernels(Network dense, SparseNetwork sparse)
+	{
+		const uint64_t batch_size = 1024;
+		const uint64_t rounds = 200;
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+		std::vector<float> batch(dense.input_size * batch_size);
+		for (float& value : batch) {
+			value = distribution(generator);
+		}
+
+		// Dense serves a batch one input at a time
+		std::vector<float> input(dense.input_size);
+		float checksum = 0.0f;
+		auto start = std::chrono::steady_clock::now();
+		for (uint64_t r(0); r < rounds; ++r) {
+			for (uint64_t b(0); b < batch_size; ++b) {
+				for (uint64_t f(0); f < dense.input_size; ++f) {
+					input[f] = batch[f * batch_size + b];
+				}
+				checksum += dense.execute(input)[0];
+			}
+		}
+		const float dense_time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		for (uint64_t r(0); r < rounds; ++r) {
+			for (uint64_t b(0); b < batch_size; ++b) {
+				for (uint64_t f(0); f < sparse.input_size; ++f) {
+					input[f] = batch[f * batch_size + b];
+				}
+				checksum += sparse.execute(input)[0];
+			}
+		}
+		const float sparse_time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		for (uint64_t r(0); r < rounds; ++r) {
+			checksum += sparse.executeBatch(batch, batch_size)[0];
+		}
+		const float batch_time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << "  Champion kernel speedup over dense: " << dense_time / sparse_time << "x single, "
+			<< dense_time / batch_time << "x batched (" << batch_size << ")" << std::endl;
+		doNotOptimize(checksum);
+	}
+};
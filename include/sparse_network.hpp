@@ -0,0 +1,147 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include "neural_network.hpp"
+
+
+/*
+	Layer with its small weights removed, the remaining ones are stored row by row (CSR).
+	Row i uses weights[row_start[i]] to weights[row_start[i + 1] - 1].
+*/
+struct SparseLayer
+{
+	SparseLayer(const Layer& layer, float threshold)
+		: inputs_count(layer.getWeightsCount())
+		, row_start(1, 0)
+		, values(layer.getNeuronsCount())
+		, bias(layer.bias)
+	{
+		const uint64_t neurons_count = layer.getNeuronsCount();
+		for (uint64_t i(0); i < neurons_count; ++i) {
+			for (uint64_t j(0); j < inputs_count; ++j) {
+				const float w = layer.weights[i][j];
+				if (std::abs(w) >= threshold) {
+					columns.push_back(static_cast<uint32_t>(j));
+					weights.push_back(w);
+				}
+			}
+			row_start.push_back(static_cast<uint32_t>(weights.size()));
+		}
+	}
+
+	uint64_t getNeuronsCount() const
+	{
+		return bias.size();
+	}
+
+	void process(const std::vector<float>& inputs)
+	{
+		const uint64_t neurons_count = bias.size();
+		for (uint64_t i(0); i < neurons_count; ++i) {
+			float result = bias[i];
+			for (uint32_t k(row_start[i]); k < row_start[i + 1]; ++k) {
+				result += weights[k] * inputs[columns[k]];
+			}
+			values[i] = tanh(4.0f * result);
+		}
+	}
+
+	// Inputs and outputs are stored feature by feature, [feature][batch], so the inner loop is contiguous
+	void processBatch(const std::vector<float>& inputs, std::vector<float>& outputs, uint64_t batch_size) const
+	{
+		const uint64_t neurons_count = bias.size();
+		outputs.resize(neurons_count * batch_size);
+		for (uint64_t i(0); i < neurons_count; ++i) {
+			float* out = &outputs[i * batch_size];
+			for (uint64_t b(0); b < batch_size; ++b) {
+				out[b] = bias[i];
+			}
+			for (uint32_t k(row_start[i]); k < row_start[i + 1]; ++k) {
+				const float w = weights[k];
+				const float* in = &inputs[columns[k] * batch_size];
+				for (uint64_t b(0); b < batch_size; ++b) {
+					out[b] += w * in[b];
+				}
+			}
+			for (uint64_t b(0); b < batch_size; ++b) {
+				out[b] = tanh(4.0f * out[b]);
+			}
+		}
+	}
+
+	uint64_t inputs_count;
+	std::vector<uint32_t> row_start;
+	std::vector<uint32_t> columns;
+	std::vector<float> weights;
+	std::vector<float> values;
+	std::vector<float> bias;
+};
+
+
+/*
+	Magnitude pruned copy of a Network, weights below threshold are dropped.
+	Biases are always kept.
+*/
+struct SparseNetwork
+{
+	SparseNetwork()
+		: input_size(0)
+	{}
+
+	SparseNetwork(const Network& network, float threshold)
+		: input_size(network.input_size)
+	{
+		for (const Layer& layer : network.layers) {
+			layers.emplace_back(layer, threshold);
+		}
+	}
+
+	const std::vector<float>& execute(const std::vector<float>& input)
+	{
+		if (input.size() == input_size) {
+			layers.front().process(input);
+			const uint64_t layers_count = layers.size();
+			for (uint64_t i(1); i < layers_count; ++i) {
+				layers[i].process(layers[i - 1].values);
+			}
+		}
+
+		return layers.back().values;
+	}
+
+	// Same layout as SparseLayer::processBatch, returns [output][batch]
+	const std::vector<float>& executeBatch(const std::vector<float>& inputs, uint64_t batch_size)
+	{
+		const std::vector<float>* current = &inputs;
+		for (uint64_t i(0); i < layers.size(); ++i) {
+			std::vector<float>& out = batch_buffers[i % 2];
+			layers[i].processBatch(*current, out, batch_size);
+			current = &out;
+		}
+		return *current;
+	}
+
+	uint64_t getNonZeroCount() const
+	{
+		uint64_t result = 0;
+		for (const SparseLayer& layer : layers) {
+			result += layer.weights.size();
+		}
+		return result;
+	}
+
+	// Fraction of the dense weights that were kept
+	float getDensity() const
+	{
+		uint64_t dense_count = 0;
+		for (const SparseLayer& layer : layers) {
+			dense_count += layer.getNeuronsCount() * layer.inputs_count;
+		}
+		return dense_count ? float(getNonZeroCount()) / float(dense_count) : 0.0f;
+	}
+
+	uint64_t input_size;
+	std::vector<SparseLayer> layers;
+	std::vector<float> batch_buffers[2];
+};
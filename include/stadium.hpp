@@ -1,10 +1,26 @@
 #pragma once
 
 #include <swarm.hpp>
+#include <atomic>
+#include <functional>
 
 #include "selector.hpp"
 #include "drone.hpp"
 #include "objective.hpp"
+#include "steady_state.hpp"
+#include "fitness_pruning.hpp"
+#include "prescreening.hpp"
+#include "scenarios.hpp"
+#include "fitness_cache.hpp"
+#include "profiler.hpp"
+#include "perf_counters.hpp"
+#include "alloc_tracker.hpp"
+
+
+// Time to stay on a target to validate it
+const float target_validation_time = 1.0f;
+// Distance a drone can go out of the area before being considered lost
+const float area_tolerance_margin = 50.0f;
 
 
 struct Stadium
@@ -14,40 +30,198 @@ struct Stadium
 		float time;
 		float best_fitness;
 		uint32_t best_unit;
+		// Summed by the update chunks
+		std::atomic<uint64_t> drone_steps;
 
 		void reset()
 		{
 			time = 0.0f;
 			best_fitness = 0.0f;
 			best_unit = 0;
+			drone_steps = 0;
 		}
 	};
 
 	uint32_t population_size;
 	Selector<Drone> selector;
 	uint32_t targets_count;
-	std::vector<sf::Vector2f> targets;
+	// Each genome is evaluated on every scenario, state is laid out as [scenario x drone]
+	uint32_t scenarios_count;
+	std::vector<std::vector<sf::Vector2f>> targets;
 	std::vector<Objective> objectives;
+	// Copies of the population flying the scenarios after the first one
+	std::vector<Drone> scenarios_drones;
+	// Drones indexes grouped by architecture, empty when they all share the same one
+	std::vector<uint32_t> update_order;
+	ScenarioAggregator aggregator;
+	// Same targets every generation, for benchmarks and validation
+	bool fixed_scenarios;
+	uint32_t scenarios_seed;
+	// With fixed scenarios, genomes already evaluated get their fitness back without flying
+	bool fitness_caching;
+	FitnessCache fitness_cache;
+	std::vector<uint64_t> genomes_hashes;
+	std::vector<uint8_t> cache_pending;
 	sf::Vector2f area_size;
 	Iteration current_iteration;
 	swrm::Swarm swarm;
+	// Drones per chunk of the parallel update
+	uint64_t update_grain;
 	float max_iteration_time;
+	std::mt19937 targets_generator;
+	// In steady state mode finished drones are replaced right away, there is no generation barrier
+	bool steady_state;
+	SteadyStateBreeder breeder;
+	// Retire drones that can no longer make it to the survivors
+	bool pruning;
+	FitnessPruner pruner;
+	// Evaluate children with a short coarse rollout first, only the best get the full one
+	bool prescreening;
+	float prescreening_dt;
+	Prescreener prescreener;
+	// Called once the new generation is bred, before it is copied to the scenarios, prescreened
+	// and looked up in the fitness cache: genomes changed here are evaluated like bred ones
+	std::function<void()> on_bred;
 
-	Stadium(uint32_t population, sf::Vector2f size)
+	// A thread count of 0 uses one thread per physical core
+	Stadium(uint32_t population, sf::Vector2f size, uint32_t thread_count = 0)
 		: population_size(population)
 		, selector(population)
 		, targets_count(10)
-		, targets(targets_count)
+		, scenarios_count(1)
+		, targets(1, std::vector<sf::Vector2f>(targets_count))
 		, objectives(population)
+		, fixed_scenarios(false)
+		, scenarios_seed(0)
+		, fitness_caching(false)
 		, area_size(size)
-		, swarm(8)
+		, swarm(thread_count)
+		, update_grain(16)
 		, max_iteration_time(100.0f)
+		, targets_generator(0)
+		, steady_state(false)
+		, breeder(selector.survivings_count)
+		, pruning(false)
+		, prescreening(false)
+		, prescreening_dt(0.008f)
+	{
+		selector.dump_swarm = &swarm;
+		selector.breed_swarm = &swarm;
+	}
+
+	// Pins the workers from the first_cpu th core on then moves the drones memory to them
+	bool pinWorkers(uint32_t first_cpu)
+	{
+		if (!swarm.pinWorkers(first_cpu)) {
+			return false;
+		}
+		firstTouch();
+		return true;
+	}
+
+	// Position of the first drone updated by a pinned worker, in update order
+	uint64_t getWorkerStart(uint32_t id, uint32_t count) const
+	{
+		return getDronesCount() * id / count;
+	}
+
+	/*
+		Buffers of the drones (genome, network) are reallocated by the worker that will update them,
+		on NUMA machines the pages are then placed on its node. Both population buffers are moved,
+		breeding copies into the existing buffers.
+	*/
+	void firstTouch()
+	{
+		std::vector<Drone>& last_population = selector.population.getLast();
+		swarm.executeOnWorkers([&](uint32_t id, uint32_t count) {
+			const uint64_t end = getWorkerStart(id + 1, count);
+			for (uint64_t i(getWorkerStart(id, count)); i < end; ++i) {
+				const uint64_t index = update_order.empty() ? i : update_order[i];
+				relocate(getDrone(index));
+				if (index < population_size) {
+					relocate(last_population[index]);
+				}
+			}
+		}).waitExecutionDone();
+	}
+
+	static void relocate(Drone& drone)
+	{
+		Drone copy(drone);
+		drone = std::move(copy);
+	}
+
+	void setTargetsSeed(uint32_t seed)
+	{
+		targets_generator = std::mt19937(seed);
+	}
+
+	// Steady state and pruning work per drone and are only available with a single scenario
+	void setScenariosCount(uint32_t count)
 	{
+		scenarios_count = std::max(1u, count);
+		targets.resize(scenarios_count, std::vector<sf::Vector2f>(targets_count));
+		objectives.resize(getDronesCount());
+		scenarios_drones.resize(getDronesCount() - population_size);
+		syncScenariosDrones();
+	}
+
+	uint64_t getDronesCount() const
+	{
+		return uint64_t(population_size) * scenarios_count;
+	}
+
+	Drone& getDrone(uint64_t i)
+	{
+		return i < population_size ? selector.getCurrentPopulation()[i] : scenarios_drones[i - population_size];
+	}
+
+	const Drone& getDrone(uint64_t i) const
+	{
+		return i < population_size ? selector.getCurrentPopulation()[i] : scenarios_drones[i - population_size];
+	}
+
+	const std::vector<sf::Vector2f>& getTargets(uint32_t drone_index) const
+	{
+		return targets[drone_index / population_size];
+	}
+
+	// Copies the units of the population, with their network, into the other scenarios drones
+	void syncScenariosDrones()
+	{
+		const std::vector<Drone>& population = selector.getCurrentPopulation();
+		for (uint64_t i(0); i < scenarios_drones.size(); ++i) {
+			// Genome, bucket and network follow the population, the evaluation state stays the copy's own
+			Drone& d = scenarios_drones[i];
+			const bool alive = d.alive;
+			const float fitness = d.fitness;
+			d = population[i % population_size];
+			d.index = as<uint32_t>(population_size + i);
+			d.alive = alive;
+			d.fitness = fitness;
+		}
+	}
+
+	// Gives to each genome its aggregated fitness over all scenarios
+	void aggregateScenariosFitness()
+	{
+		if (scenarios_count == 1) {
+			return;
+		}
+
+		std::vector<Drone>& population = selector.getCurrentPopulation();
+		for (Drone& d : population) {
+			aggregator.samples.clear();
+			for (uint32_t s(0); s < scenarios_count; ++s) {
+				aggregator.samples.push_back(getDrone(uint64_t(s) * population_size + d.index).fitness);
+			}
+			d.fitness = aggregator.aggregate();
+		}
 	}
 
 	void loadDnaFromFile(const std::string& filename)
 	{
-		const uint64_t bytes_count = Network::getParametersCount(architecture) * 4;
+		const uint64_t bytes_count = Network::getParametersCount(getArchitecture()) * DNA::getGeneBytes();
 		const uint64_t dna_count = DnaLoader::getDnaCount(filename, bytes_count);
 		for (uint64_t i(0); i < dna_count && i < population_size; ++i) {
 			const DNA dna = DnaLoader::loadDnaFrom(filename, bytes_count, i);
@@ -58,17 +232,24 @@ struct Stadium
 	void initializeTargets()
 	{
 		// Initialize targets
+		if (fixed_scenarios) {
+			setTargetsSeed(scenarios_seed);
+		}
 		const float border = 200.0f;
-		for (uint32_t i(0); i < targets_count; ++i) {
-			targets[i] = sf::Vector2f(border + getRandUnder(area_size.x - 2.0f * border), border + getRandUnder(area_size.y - 2.0f * border));
+		for (std::vector<sf::Vector2f>& scenario_targets : targets) {
+			for (sf::Vector2f& target : scenario_targets) {
+				target = sf::Vector2f(border + getRandUnder(area_size.x - 2.0f * border, targets_generator), border + getRandUnder(area_size.y - 2.0f * border, targets_generator));
+			}
 		}
 	}
 
 	void finalizeFitness()
 	{
-		for (Drone& d : selector.getCurrentPopulation()) {
+		const uint64_t drones_count = getDronesCount();
+		for (uint64_t i(0); i < drones_count; ++i) {
+			Drone& d = getDrone(i);
 			const Objective& current_objective = objectives[d.index];
-			const float dist = getLength(d.position - current_objective.getTarget(targets));
+			const float dist = getLength(d.position - current_objective.getTarget(getTargets(d.index)));
 			const float points = current_objective.points - dist;
 			d.fitness += std::max(0.0f, points / (1.0f + current_objective.time_out));
 		}
@@ -76,17 +257,48 @@ struct Stadium
 
 	void initializeDrones()
 	{
-		// Initialize targets
-		auto& drones = selector.getCurrentPopulation();
-		uint32_t i = 0;
-		for (Drone& d : drones) {
-			d.index = i++;
-			Objective& objective = objectives[d.index];
-			d.position = 0.5f * area_size;
-			objective.reset();
-			objective.points = getLength(d.position - targets[0]);
-			d.reset();
+		const uint64_t drones_count = getDronesCount();
+		for (uint64_t i(0); i < drones_count; ++i) {
+			Drone& d = getDrone(i);
+			d.index = as<uint32_t>(i);
+			initializeDrone(d);
 		}
+		groupByBucket();
+	}
+
+	// Drones of a same architecture are updated one after another
+	void groupByBucket()
+	{
+		update_order.clear();
+		if (getBucketsCount() < 2) {
+			return;
+		}
+		const uint64_t drones_count = getDronesCount();
+		for (uint64_t i(0); i < drones_count; ++i) {
+			update_order.push_back(as<uint32_t>(i));
+		}
+		std::stable_sort(update_order.begin(), update_order.end(), [&](uint32_t a, uint32_t b) {
+			return getDrone(a).bucket < getDrone(b).bucket;
+		});
+	}
+
+	// Spreads the initial population evenly over the architecture buckets
+	void assignBuckets()
+	{
+		std::vector<Drone>& population = selector.getCurrentPopulation();
+		for (uint64_t i(0); i < population.size(); ++i) {
+			population[i].setBucket(as<uint32_t>(i % getBucketsCount()));
+		}
+		syncScenariosDrones();
+	}
+
+	void initializeDrone(Drone& d)
+	{
+		Objective& objective = objectives[d.index];
+		d.position = 0.5f * area_size;
+		objective.reset();
+		objective.points = getLength(d.position - getTargets(d.index)[0]);
+		d.reset();
 	}
 
 	bool checkAlive(const Drone& drone, float tolerance) const
@@ -98,10 +310,11 @@ struct Stadium
 
 	uint32_t getAliveCount() const
 	{
+		PROFILE_SCOPE(AliveScan);
 		uint32_t result = 0;
-		const auto& drones = selector.getCurrentPopulation();
-		for (const Drone& d : drones) {
-			result += d.alive;
+		const uint64_t drones_count = getDronesCount();
+		for (uint64_t i(0); i < drones_count; ++i) {
+			result += getDrone(i).alive;
 		}
 
 		return result;
@@ -109,7 +322,7 @@ struct Stadium
 
 	void updateDrone(uint64_t i, float dt, bool update_smoke)
 	{
-		Drone& d = selector.getCurrentPopulation()[i];
+		Drone& d = getDrone(i);
 		if (!d.alive) {
 			// It's too late for it
 			return;
@@ -117,40 +330,58 @@ struct Stadium
 
 		const float target_radius = 8.0f;
 		const float max_dist = 700.0f;
-		const float tolerance_margin = 50.0f;
-		
+
 		Objective& objective = objectives[d.index];
-		sf::Vector2f to_target = objective.getTarget(targets) - d.position;
+		const std::vector<sf::Vector2f>& drone_targets = getTargets(d.index);
+		sf::Vector2f to_target = objective.getTarget(drone_targets) - d.position;
 		const float to_target_dist = getLength(to_target);
 		to_target.x /= std::max(to_target_dist, max_dist);
 		to_target.y /= std::max(to_target_dist, max_dist);
 
-		const std::vector<float> inputs = {
-			to_target.x,
-			to_target.y,
-			d.velocity.x * dt,
-			d.velocity.y * dt,
-			cos(d.angle),
-			sin(d.angle),
-			d.angular_velocity * dt
-		};
+		// Reused by every drone the thread updates, only its first use allocates
+		thread_local std::vector<float> inputs;
+		if (inputs.empty()) {
+			ALLOC_PERMIT();
+			inputs.resize(7);
+		}
+		inputs[0] = to_target.x;
+		inputs[1] = to_target.y;
+		inputs[2] = d.velocity.x * dt;
+		inputs[3] = d.velocity.y * dt;
+		inputs[4] = cos(d.angle);
+		inputs[5] = sin(d.angle);
+		inputs[6] = d.angular_velocity * dt;
 
 		// The actual update
-		d.execute(inputs);
-		d.update(dt, update_smoke);
-		d.alive = checkAlive(d, tolerance_margin);
+		PROFILE_SAMPLE();
+		{
+			PROFILE_SAMPLED_SCOPE(Inference);
+			if (perf::sampleInference()) {
+				const perf::Scope perf_scope(perf::Phase::Inference);
+				d.execute(inputs);
+			}
+			else {
+				d.execute(inputs);
+			}
+		}
+		{
+			PROFILE_SAMPLED_SCOPE(Physics);
+			d.update(dt, update_smoke);
+			d.alive = checkAlive(d, area_tolerance_margin);
+		}
+		objective.lifetime += dt;
 
 		// Fitness stuffs
+		PROFILE_SAMPLED_SCOPE(Fitness);
 		d.fitness += 1.0f / (1.0f + to_target_dist);
 		// We don't want weirdos
 		const float score_factor = std::pow(cos(d.angle), 2.0f);
-		const float target_time = 1.0f;
 		if (to_target_dist < target_radius + d.radius) {
 			objective.addTimeIn(dt);
-			if (objective.time_in > target_time) {
+			if (objective.time_in > target_validation_time) {
 				d.fitness += score_factor * objective.points / (1.0f + objective.time_out);
-				objective.nextTarget(targets);
-				objective.points = getLength(d.position - objective.getTarget(targets));
+				objective.nextTarget(drone_targets);
+				objective.points = getLength(d.position - objective.getTarget(drone_targets));
 			}
 		}
 		else {
@@ -160,6 +391,23 @@ struct Stadium
 		checkBestFitness(d.fitness, d.index);
 	}
 
+	// Drones from start to end in update order
+	void updateChunk(uint64_t start, uint64_t end, float dt, bool update_smoke)
+	{
+		ALLOC_PHASE(Step);
+		perf::Scope perf_scope(perf::Phase::Update, 0);
+		// Checked in builds with AUTODRONE_ALLOC_TRACKING
+		ALLOC_FREE_REGION();
+		uint64_t alive_count = 0;
+		for (uint64_t i(start); i < end; ++i) {
+			const uint64_t index = update_order.empty() ? i : update_order[i];
+			alive_count += getDrone(index).alive;
+			updateDrone(index, dt, update_smoke);
+		}
+		perf_scope.addItems(alive_count);
+		current_iteration.drone_steps.fetch_add(alive_count, std::memory_order_relaxed);
+	}
+
 	void checkBestFitness(float fitness, uint32_t id)
 	{
 		if (fitness > current_iteration.best_fitness) {
@@ -170,23 +418,246 @@ struct Stadium
 
 	void update(float dt, bool update_smoke)
 	{
-		const uint64_t population_size = selector.getCurrentPopulation().size();
-		auto group_update = swarm.execute([&](uint32_t thread_id, uint32_t max_thread) {
-			const uint64_t thread_width = population_size / max_thread;
-			for (uint64_t i(thread_id * thread_width); i < (thread_id + 1) * thread_width; ++i) {
-				updateDrone(i, dt, update_smoke);
-			}
-		});
-		group_update.waitExecutionDone();
+		ALLOC_PHASE(Step);
+		ALLOC_UNIT(Step);
+		// Drones of all scenarios are updated in the same batch
+		const uint64_t drones_count = getDronesCount();
+		if (swarm.isPinned()) {
+			// Pinned workers always update the drones they first touched, their memory stays local
+			swarm.executeOnWorkers([&](uint32_t id, uint32_t count) {
+				const uint64_t end = getWorkerStart(id + 1, count);
+				updateChunk(getWorkerStart(id, count), end, dt, update_smoke);
+			}).waitExecutionDone();
+		}
+		else {
+			// Chunks are taken dynamically, threads that only meet dead drones pick more of them
+			swarm.parallel_for(0, drones_count, update_grain, [&](uint64_t start, uint64_t end) {
+				updateChunk(start, end, dt, update_smoke);
+			});
+		}
 		current_iteration.time += dt;
+
+		if (scenarios_count > 1) {
+			return;
+		}
+
+		if (steady_state && !isFirstIteration()) {
+			replaceFinishedDrones();
+		}
+		else if (pruning && pruner.isCheckDue()) {
+			pruneHopelessDrones(dt);
+		}
+	}
+
+	/*
+		Upper bound of the fitness a drone can still gain before the end of the iteration:
+		 - the proximity reward is at most 1 per step
+		 - each target needs target_validation_time inside it and is worth at most its points,
+		   the next targets can't be worth more than the largest distance in the area
+		 - the final bonus of finalizeFitness is also bounded by the current target points
+	*/
+	float getFitnessUpperBound(const Drone& d, uint64_t remaining_steps, float dt) const
+	{
+		const Objective& objective = objectives[d.index];
+		const sf::Vector2f margin(area_tolerance_margin, area_tolerance_margin);
+		const float max_points = getLength(area_size + 2.0f * margin);
+		// Floor minus one to stay on the safe side of float accumulation
+		const uint64_t steps_per_target = std::max<int64_t>(1, int64_t(target_validation_time / dt) - 1);
+		const uint64_t next_targets = remaining_steps / steps_per_target;
+		return float(remaining_steps) + objective.points + next_targets * max_points + max_points;
+	}
+
+	void pruneHopelessDrones(float dt)
+	{
+		const float remaining_time = max_iteration_time - current_iteration.time;
+		if (remaining_time < 0.0f) {
+			return;
+		}
+
+		std::vector<Drone>& drones = selector.getCurrentPopulation();
+		const float cutoff = pruner.getCutoff(drones, selector.survivings_count);
+		const uint64_t remaining_steps = uint64_t(remaining_time / dt) + 1;
+		for (Drone& d : drones) {
+			if (d.alive && pruner.isHopeless(d.fitness, getFitnessUpperBound(d, remaining_steps, dt), cutoff)) {
+				d.alive = false;
+				pruner.onPruned(remaining_steps);
+			}
+		}
+	}
+
+	void replaceFinishedDrones()
+	{
+		for (Drone& d : selector.getCurrentPopulation()) {
+			if (d.alive && objectives[d.index].lifetime <= max_iteration_time) {
+				continue;
+			}
+
+			breeder.add(d.dna, d.fitness);
+			breeder.breed(d.dna);
+			d.reloadDNA();
+			initializeDrone(d);
+			// A generation is now just a population worth of births
+			if (!(breeder.births % population_size)) {
+				nextSteadyStateGeneration();
+			}
+		}
+	}
+
+	void nextSteadyStateGeneration()
+	{
+		const swrm::TraceScope trace("generation");
+		ALLOC_UNIT(Selection);
+		std::cout << "Gen: " << selector.generation << " Best: " << breeder.getBestFitness() << std::endl;
+		if (!(selector.generation % selector.dump_frequency) && !breeder.pool.empty()) {
+			selector.dump(breeder.pool.front().dna);
+		}
+		++selector.generation;
+		// Drone steps keep adding up, steady state has no iteration to count them over
+		const uint64_t drone_steps = current_iteration.drone_steps;
+		current_iteration.reset();
+		current_iteration.drone_steps = drone_steps;
+		// Each virtual generation flies new targets, drones in flight restart on their current one
+		initializeTargets();
+		for (Drone& d : selector.getCurrentPopulation()) {
+			Objective& objective = objectives[d.index];
+			objective.time_in = 0.0f;
+			objective.points = getLength(d.position - objective.getTarget(getTargets(d.index)));
+		}
+	}
+
+	bool isFitnessCacheActive() const
+	{
+		// Pruned drones don't have their real fitness
+		return fitness_caching && fixed_scenarios && !steady_state && !pruning;
+	}
+
+	FitnessCache::Key getCacheKey(uint64_t drone_index) const
+	{
+		const uint64_t scenario = drone_index / population_size;
+		return {genomes_hashes[drone_index % population_size], (uint64_t(scenarios_seed) << 32) | scenario};
+	}
+
+	// Drones whose genome already flew the same scenario are not scheduled
+	void applyFitnessCache()
+	{
+		if (!isFitnessCacheActive()) {
+			return;
+		}
+
+		const std::vector<Drone>& population = selector.getCurrentPopulation();
+		genomes_hashes.resize(population_size);
+		for (const Drone& d : population) {
+			genomes_hashes[d.index] = FitnessCache::hash(d.dna);
+		}
+
+		const uint64_t drones_count = getDronesCount();
+		cache_pending.assign(drones_count, 0);
+		for (uint64_t i(0); i < drones_count; ++i) {
+			Drone& d = getDrone(i);
+			if (!d.alive) {
+				continue;
+			}
+
+			float fitness;
+			if (fitness_cache.find(getCacheKey(i), fitness)) {
+				d.fitness = fitness;
+				d.alive = false;
+			}
+			else {
+				cache_pending[i] = 1;
+			}
+		}
+	}
+
+	void storeFitnessCache()
+	{
+		if (!isFitnessCacheActive() || cache_pending.empty()) {
+			return;
+		}
+
+		for (uint64_t i(0); i < cache_pending.size(); ++i) {
+			if (cache_pending[i]) {
+				fitness_cache.add(getCacheKey(i), getDrone(i).fitness);
+			}
+		}
+		cache_pending.clear();
+		std::cout << "Fitness cache hit ratio: " << fitness_cache.getHitRatio() << " (" << fitness_cache.entries.size() << " entries)" << std::endl;
 	}
 
 	void newIteration()
 	{
-		selector.nextGeneration();
+		const swrm::TraceScope trace("generation");
+		ALLOC_PHASE(Selection);
+		ALLOC_UNIT(Selection);
+		storeFitnessCache();
+		aggregateScenariosFitness();
+		if (prescreener.pending) {
+			prescreener.finalize(selector.getCurrentPopulation(), current_iteration.drone_steps);
+		}
+		{
+			PROFILE_SCOPE(Selection);
+			const perf::Scope perf_scope(perf::Phase::Selection);
+			selector.startNextGeneration();
+			// Targets don't depend on the genomes, they are drawn while offspring are bred
+			initializeTargets();
+			selector.waitBreeding();
+		}
+		if (on_bred) {
+			on_bred();
+		}
+		syncScenariosDrones();
+		initializeDrones();
+		current_iteration.reset();
+
+		if (prescreening && !steady_state) {
+			runPrescreening(prescreening_dt);
+		}
+		applyFitnessCache();
+	}
+
+	// prescreening_dt is the full evaluation time step, the screening one is dt_factor times larger
+	void runPrescreening(float dt)
+	{
+		const bool pruning_state = pruning;
+		pruning = false;
+		const float screening_dt = dt * prescreener.dt_factor;
+		const float horizon = max_iteration_time * prescreener.horizon_ratio;
+		while (getAliveCount() && current_iteration.time <= horizon) {
+			update(screening_dt, false);
+		}
+		pruning = pruning_state;
+
+		aggregateScenariosFitness();
+		// Optimizers don't carry units over
+		prescreener.select(selector.getCurrentPopulation(), current_iteration.drone_steps, selector.optimizer ? 0 : selector.elites_count);
+		// Back to the starting line, only promoted drones will fly
+		initializeDrones();
+		current_iteration.reset();
+		const uint64_t drones_count = getDronesCount();
+		for (uint64_t i(0); i < drones_count; ++i) {
+			getDrone(i).alive = prescreener.isPromoted(as<uint32_t>(i % population_size));
+		}
+	}
+
+	// Runs a full iteration on the current population, without breeding a new one
+	void evaluatePopulation(float dt)
+	{
+		syncScenariosDrones();
 		initializeTargets();
 		initializeDrones();
 		current_iteration.reset();
+		applyFitnessCache();
+		while (getAliveCount() && current_iteration.time <= max_iteration_time) {
+			update(dt, false);
+		}
+		storeFitnessCache();
+		aggregateScenariosFitness();
+	}
+
+	// Best fitness of the last generation, or seen so far in steady state mode
+	float getBestFitness() const
+	{
+		return steady_state ? breeder.getBestFitness() : selector.getBest().fitness;
 	}
 
 	bool isFirstIteration() const
@@ -196,6 +667,9 @@ struct Stadium
 
 	bool isDone() const
 	{
+		if (steady_state) {
+			return isFirstIteration();
+		}
 		return getAliveCount() == 0 || current_iteration.time > max_iteration_time || isFirstIteration();
 	}
 };
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include "dna_utils.hpp"
+
+
+/*
+	Rolling pool of the best genomes seen so far, used to breed a child as soon as a slot is freed
+	instead of waiting for the whole generation to be done.
+*/
+struct SteadyStateBreeder
+{
+	struct Entry
+	{
+		DNA dna;
+		float fitness;
+	};
+
+	std::vector<Entry> pool;
+	uint32_t capacity;
+	uint64_t births;
+
+	// A pool of at least one genome, small populations may keep no survivor
+	SteadyStateBreeder(uint32_t capacity_)
+		: capacity(std::max(1u, capacity_))
+		, births(0)
+	{
+		pool.reserve(capacity + 1);
+	}
+
+	// Inserts the genome keeping the pool sorted by decreasing fitness, the worst is dropped when full
+	void add(const DNA& dna, float fitness)
+	{
+		if (pool.size() == capacity && fitness <= pool.back().fitness) {
+			return;
+		}
+		const auto it = std::upper_bound(pool.begin(), pool.end(), fitness, [](float f, const Entry& e) { return f > e.fitness; });
+		pool.insert(it, Entry{dna, fitness});
+		if (pool.size() > capacity) {
+			pool.pop_back();
+		}
+	}
+
+	const Entry& pick() const
+	{
+		float total = 0.0f;
+		for (const Entry& e : pool) {
+			total += e.fitness;
+		}
+
+		const float value = NumberGenerator<>::getInstance().getUnder(total);
+		float acc = 0.0f;
+		for (const Entry& e : pool) {
+			acc += e.fitness;
+			if (acc > value) {
+				return e;
+			}
+		}
+		return pool.back();
+	}
+
+	// child is kept as is while the pool is empty
+	void breed(DNA& child)
+	{
+		++births;
+		if (pool.empty()) {
+			return;
+		}
+		const Entry& parent_1 = pick();
+		const Entry& parent_2 = pick();
+		DNAUtils::breed(parent_1.dna, parent_1.fitness, parent_2.dna, parent_2.fitness, child);
+	}
+
+	float getBestFitness() const
+	{
+		return pool.empty() ? 0.0f : pool.front().fitness;
+	}
+};
@@ -20,9 +20,23 @@ struct Unit
 		onUpdateDNA();
 	}
 
+	// Same as loadDNA for a genome written in place in dna
+	void reloadDNA()
+	{
+		fitness = 0.0f;
+		onUpdateDNA();
+	}
+
 	virtual void onUpdateDNA() = 0;
 
+	// Units can only breed with units of the same bucket
+	virtual void setBucket(uint32_t new_bucket)
+	{
+		bucket = new_bucket;
+	}
+
 	DNA dna;
 	float fitness;
 	bool alive;
+	uint32_t bucket = 0;
 };
@@ -102,3 +102,16 @@ T clamp(const T& min_val, const T& max_val, const T& value)
 {
 	return std::min(max_val, std::max(min_val, value));
 }
+
+
+// Hands value to the optimizer as if it were read, so that the code computing it is kept
+template<typename T>
+void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	const volatile T sink = value;
+	(void)sink;
+#endif
+}
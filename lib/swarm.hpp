@@ -2,344 +2,734 @@
 
 #include <thread>
 #include <mutex>
-#include <list>
+#include <vector>
 #include <functional>
 #include <atomic>
-#include <iostream>
-#include <chrono>
 #include <condition_variable>
 #include <memory>
+#include <new>
+#include <cstddef>
+#include <climits>
+#include <type_traits>
+#include <deque>
+#include <optional>
+#include <exception>
+#include "topology.hpp"
+#include "tracer.hpp"
+
+#if defined(__linux__)
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+	#include <immintrin.h>
+#endif
 
 namespace swrm
 {
 
-class Swarm;
-class ExecutionGroup;
-
 using WorkerFunction = std::function<void(uint32_t, uint32_t)>;
 
-class Worker
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+	_mm_pause();
+#else
+	std::this_thread::yield();
+#endif
+}
+
+/*
+	32 bits word threads can sleep on until it changes.
+	Futex on Linux, mutex and condition variable elsewhere.
+*/
+class WaitWord
 {
 public:
-	Worker(Swarm* swarm);
+	WaitWord(uint32_t value = 0)
+		: m_value(value)
+	{}
 
-	void createThread();
+	uint32_t load() const
+	{
+		return m_value.load(std::memory_order_acquire);
+	}
 
-	void lockReady();
-	void lockDone();
-	void unlockReady();
-	void unlockDone();
+	// Sequentially consistent so that the sleepers count read by wakeAll can't move before the write
+	void store(uint32_t value)
+	{
+		m_value.store(value, std::memory_order_seq_cst);
+	}
 
-	void setJob(uint32_t id, ExecutionGroup* group);
-	void stop();
-	void join();
+	uint32_t increment()
+	{
+		return m_value.fetch_add(1, std::memory_order_seq_cst) + 1;
+	}
 
-private:
-	bool m_running;
-	uint32_t m_id;
-	uint32_t m_group_size;
+	// Spins for a while then sleeps until the value differs from expected
+	void waitWhileEqual(uint32_t expected, uint32_t spin_count)
+	{
+		for (uint32_t i(0); i < spin_count; ++i) {
+			if (load() != expected) {
+				return;
+			}
+			// Yielding from time to time keeps spinning cheap when there are more threads than cores
+			if ((i & 63) == 63) {
+				std::this_thread::yield();
+			}
+			else {
+				cpuRelax();
+			}
+		}
 
-	Swarm* m_swarm;
-	ExecutionGroup* m_group;
-	std::thread     m_thread;
-	WorkerFunction  m_job;
+		m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+		while (m_value.load(std::memory_order_seq_cst) == expected) {
+#if defined(__linux__)
+			syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_value), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [&] { return m_value.load() != expected; });
+#endif
+		}
+		m_sleepers.fetch_sub(1, std::memory_order_seq_cst);
+	}
 
-	std::mutex m_ready_mutex;
-	std::mutex m_done_mutex;
+	// No system call when nobody sleeps
+	void wakeAll()
+	{
+		if (!m_sleepers.load(std::memory_order_seq_cst)) {
+			return;
+		}
+#if defined(__linux__)
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_value), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_condition.notify_all();
+#endif
+	}
 
-	void run();
-	void waitReady();
-	void waitDone();
+private:
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex needs a plain 32 bits word");
+	std::atomic<uint32_t> m_value;
+	std::atomic<uint32_t> m_sleepers{0};
+#if !defined(__linux__)
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+#endif
 };
 
-class Synchronizer
+/*
+	Type erased job stored in place, no allocation as long as the callable fits the buffer.
+*/
+class InlineJob
 {
 public:
-	static void lockAtReady(std::list<Worker*>& workers)
+	static constexpr size_t capacity = 128;
+
+	InlineJob() = default;
+	InlineJob(const InlineJob&) = delete;
+	InlineJob& operator=(const InlineJob&) = delete;
+
+	~InlineJob()
 	{
-		for (Worker* worker : workers) {
-			worker->lockReady();
-		}
+		reset();
 	}
 
-	static void unlockAtReady(std::list<Worker*>& workers)
+	template<typename F>
+	void set(F&& job)
 	{
-		for (Worker* worker : workers) {
-			worker->unlockReady();
+		using Job = typename std::decay<F>::type;
+		reset();
+		if (sizeof(Job) <= capacity && alignof(Job) <= alignof(std::max_align_t)) {
+			new (m_storage) Job(std::forward<F>(job));
+			m_invoke  = [](void* data, uint32_t id, uint32_t count) { (*static_cast<Job*>(data))(id, count); };
+			m_destroy = [](void* data) { static_cast<Job*>(data)->~Job(); };
+		}
+		else {
+			// Too large, kept on the heap
+			Job** slot = reinterpret_cast<Job**>(m_storage);
+			*slot = new Job(std::forward<F>(job));
+			m_invoke  = [](void* data, uint32_t id, uint32_t count) { (**static_cast<Job**>(data))(id, count); };
+			m_destroy = [](void* data) { delete *static_cast<Job**>(data); };
 		}
 	}
 
-	static void lockAtDone(std::list<Worker*>& workers)
+	void operator()(uint32_t id, uint32_t count)
 	{
-		for (Worker* worker : workers) {
-			worker->lockDone();
-		}
+		m_invoke(m_storage, id, count);
 	}
 
-	static void unlockAtDone(std::list<Worker*>& workers)
+	void reset()
 	{
-		for (Worker* worker : workers) {
-			worker->unlockDone();
+		if (m_destroy) {
+			m_destroy(m_storage);
+			m_destroy = nullptr;
+			m_invoke = nullptr;
 		}
 	}
 
-	static void stop(std::list<Worker*>& workers)
+private:
+	alignas(std::max_align_t) unsigned char m_storage[capacity];
+	void (*m_invoke)(void*, uint32_t, uint32_t) = nullptr;
+	void (*m_destroy)(void*) = nullptr;
+};
+
+class Swarm;
+
+/*
+	Node of the task graph, scheduled once all its dependencies are done.
+*/
+class Task
+{
+public:
+	virtual ~Task() = default;
+
+	virtual void execute() = 0;
+
+	bool isDone() const
 	{
-		for (Worker* worker : workers) {
-			worker->stop();
-		}
+		return m_done.load() != 0;
 	}
 
-	static void join(std::list<Worker*>& workers)
+private:
+	// One extra count is held until the task is submitted
+	std::atomic<int32_t> m_dependencies{1};
+	std::mutex m_mutex;
+	std::vector<std::shared_ptr<Task>> m_continuations;
+	bool m_finished = false;
+	WaitWord m_done;
+
+	friend Swarm;
+};
+
+using TaskPtr = std::shared_ptr<Task>;
+
+template<typename R>
+class ResultTask : public Task
+{
+public:
+	template<typename F>
+	ResultTask(F&& function)
+		: m_function(std::forward<F>(function))
+	{}
+
+	void execute() override
 	{
-		for (Worker* worker : workers) {
-			worker->join();
+		try {
+			if constexpr (std::is_void<R>::value) {
+				m_function();
+			}
+			else {
+				m_value.emplace(m_function());
+			}
+		}
+		catch (...) {
+			m_error = std::current_exception();
 		}
+		// Captures are released as soon as possible
+		m_function = nullptr;
 	}
+
+	std::function<R()> m_function;
+	std::optional<typename std::conditional<std::is_void<R>::value, char, R>::type> m_value;
+	std::exception_ptr m_error;
 };
 
-class ExecutionGroup
+template<typename R>
+class Future
 {
 public:
-	ExecutionGroup(WorkerFunction job, uint32_t group_size, std::list<Worker*>& available_workers)
-		: m_job(job)
-		, m_group_size(group_size)
-		, m_done_count(0U)
-		, m_condition()
-		, m_condition_mutex()
-	{
-		retrieveWorkers(available_workers);
-		start();
-	}
+	Future() = default;
 
-	~ExecutionGroup()
-	{
-	}
+	Future(Swarm* swarm, std::shared_ptr<ResultTask<R>> task)
+		: m_swarm(swarm)
+		, m_task(task)
+	{}
 
-	void start()
+	bool valid() const
 	{
-		m_done_count = 0U;
-		Synchronizer::lockAtDone(m_workers);
-		Synchronizer::unlockAtReady(m_workers);
+		return m_task != nullptr;
 	}
 
-	void waitExecutionDone()
+	bool isReady() const
 	{
-		waitWorkersDone();
-		Synchronizer::lockAtReady(m_workers);
-		Synchronizer::unlockAtDone(m_workers);
-		m_workers.clear();
+		return m_task && m_task->isDone();
 	}
 
-private:
-	const uint32_t       m_group_size;
-	const WorkerFunction m_job;
-	std::list<Worker*>   m_workers;
-
-	std::atomic<uint32_t>   m_done_count;
-	std::condition_variable m_condition;
-	std::mutex              m_condition_mutex;
+	// The waiting thread runs pending tasks meanwhile
+	inline void wait() const;
 
-	void notifyWorkerDone()
+	R get() const
 	{
-		{
-			std::lock_guard<std::mutex> lg(m_condition_mutex);
-			++m_done_count;
+		wait();
+		if (m_task->m_error) {
+			std::rethrow_exception(m_task->m_error);
+		}
+		if constexpr (!std::is_void<R>::value) {
+			return *m_task->m_value;
 		}
-		m_condition.notify_one();
 	}
 
-	void waitWorkersDone()
-	{
-		std::unique_lock<std::mutex> ul(m_condition_mutex);
-		m_condition.wait(ul, [this] { return m_done_count == m_group_size; });
-	}
+	// Continuation receiving the result, or nothing for void futures
+	template<typename F>
+	inline auto then(F&& function) const;
 
-	void retrieveWorkers(std::list<Worker*>& available_workers)
+	TaskPtr getTask() const
 	{
-		for (uint32_t i(m_group_size); i--;) {
-			Worker* worker = available_workers.front();
-			available_workers.pop_front();
-			worker->setJob(i, this);
-			m_workers.push_back(worker);
-		}
+		return m_task;
 	}
 
-	friend Worker;
+private:
+	Swarm* m_swarm = nullptr;
+	std::shared_ptr<ResultTask<R>> m_task;
 };
 
 class WorkGroup
 {
 public:
 	WorkGroup()
-		: m_group(nullptr)
+		: m_swarm(nullptr)
+		, m_epoch(0)
 	{}
 
-	WorkGroup(std::shared_ptr<ExecutionGroup> execution_group)
-		: m_group(execution_group)
+	WorkGroup(Swarm* swarm, uint32_t epoch)
+		: m_swarm(swarm)
+		, m_epoch(epoch)
 	{}
 
-	void waitExecutionDone()
-	{
-		if (m_group) {
-			m_group->waitExecutionDone();
-		}
-	}
+	inline void waitExecutionDone();
 
 private:
-	std::shared_ptr<ExecutionGroup> m_group;
+	Swarm*   m_swarm;
+	uint32_t m_epoch;
 };
 
+/*
+	Fixed pool of threads running fork-join groups and a task graph.
+
+	Fork-join: a dispatch publishes the job and bumps an epoch, ids are then claimed one by one
+	by whoever is free, including the thread waiting for the group, so a worker busy with a
+	long task never holds a group back. Only one group runs at a time and execute is meant to
+	be called from one thread at a time.
+
+	Tasks: each worker has its own deque, it pushes and pops at the back and steals from the
+	front of the others when empty. Tasks submitted from outside go to a shared queue.
+
+	Bound groups run their job exactly once on every worker, with the worker index as id,
+	for work that has to stay on the same thread, e.g. memory first touched by a pinned worker.
+	They can't be dispatched from a worker.
+
+	Idle workers spin for a while on a signal word before sleeping on a futex.
+*/
 class Swarm
 {
 public:
+	// Iterations spent spinning before sleeping, a few tens of microseconds
+	static constexpr uint32_t spin_count = 4096;
+
+	// A thread count of 0 uses one thread per physical core
 	Swarm(uint32_t thread_count)
-		: m_thread_count(thread_count)
-		, m_ready_count(0U)
+		: m_thread_count(thread_count ? thread_count : Topology::get().getDefaultThreadCount())
+		, m_group_size(0)
+		, m_claim(0)
+		, m_remaining(0)
+		, m_pending_tasks(0)
+		, m_running(true)
+		, m_pinned(false)
+		, m_index(s_count++)
 	{
-		for (uint32_t i(thread_count); i--;) {
-			createWorker();
+		for (uint32_t i(0); i < m_thread_count; ++i) {
+			m_queues.push_back(std::make_unique<TaskQueue>());
+		}
+		Tracer::get().setSwarmThreadCount(m_index, m_thread_count);
+		m_threads.reserve(m_thread_count);
+		for (uint32_t i(0); i < m_thread_count; ++i) {
+			m_threads.emplace_back(&Swarm::run, this, i);
 		}
-
-		while (m_ready_count < m_thread_count) {}
 	}
 
 	~Swarm()
 	{
-		Synchronizer::stop(m_workers);
-		Synchronizer::unlockAtReady(m_workers);
-		Synchronizer::join(m_workers);
-		deleteWorkers();
+		waitDone(m_epoch.load());
+		waitAllTasks();
+		m_running = false;
+		signal();
+		for (std::thread& thread : m_threads) {
+			thread.join();
+		}
 	}
 
-	WorkGroup execute(WorkerFunction job, uint32_t group_size = 0)
+	Swarm(const Swarm&) = delete;
+	Swarm& operator=(const Swarm&) = delete;
+
+	// Job is called with (id, group_size) for every id in [0, group_size), group_size defaults to the thread count
+	template<typename F>
+	WorkGroup execute(F&& job, uint32_t group_size = 0)
 	{
-		if (!group_size) {
-			group_size = m_thread_count;
-		}
+		return dispatch(std::forward<F>(job), group_size ? group_size : m_thread_count, false);
+	}
+
+	// Job is called once by each worker with (worker_index, thread_count)
+	template<typename F>
+	WorkGroup executeOnWorkers(F&& job)
+	{
+		return dispatch(std::forward<F>(job), m_thread_count, true);
+	}
 
-		if (group_size > m_available_workers.size()) {
-			return WorkGroup();
+	// Calls fn(chunk_begin, chunk_end) over [begin, end) in chunks of grain indexes taken dynamically, blocking
+	template<typename F>
+	void parallel_for(uint64_t begin, uint64_t end, uint64_t grain, F&& fn)
+	{
+		if (begin >= end) {
+			return;
 		}
+		grain = std::max<uint64_t>(1, grain);
+		std::atomic<uint64_t> next(begin);
+		execute([&](uint32_t, uint32_t) {
+			while (true) {
+				const uint64_t chunk_begin = next.fetch_add(grain, std::memory_order_relaxed);
+				if (chunk_begin >= end) {
+					break;
+				}
+				fn(chunk_begin, std::min(end, chunk_begin + grain));
+			}
+		}).waitExecutionDone();
+	}
 
-		return WorkGroup(std::make_unique<ExecutionGroup>(job, group_size, m_available_workers));
+	// Runs function on a worker, the result is available through the returned future
+	template<typename F>
+	auto async(F&& function)
+	{
+		return after({}, std::forward<F>(function));
 	}
 
+	// Same as async, once all dependencies are done
+	template<typename F>
+	auto after(const std::vector<TaskPtr>& dependencies, F&& function)
+	{
+		using R = decltype(function());
+		auto task = std::make_shared<ResultTask<R>>(std::forward<F>(function));
+		m_pending_tasks.fetch_add(1, std::memory_order_relaxed);
+		task->m_dependencies.fetch_add(int32_t(dependencies.size()), std::memory_order_relaxed);
+		for (const TaskPtr& dependency : dependencies) {
+			addContinuation(*dependency, task);
+		}
+		release(task);
+		return Future<R>(this, task);
+	}
 
-private:
-	const uint32_t m_thread_count;
+	// Helps running tasks until this one is done
+	void waitFor(Task& task)
+	{
+		while (!task.isDone()) {
+			if (!runOneTask()) {
+				task.m_done.waitWhileEqual(0, spin_count);
+			}
+		}
+	}
 
-	std::atomic<uint32_t> m_ready_count;
-	std::list<Worker*>  m_workers;
-	std::list<Worker*>  m_available_workers;
-	std::mutex m_mutex;
+	void waitAllTasks()
+	{
+		while (m_pending_tasks.load()) {
+			if (!runOneTask()) {
+				std::this_thread::yield();
+			}
+		}
+	}
 
-	void createWorker()
+	uint32_t getThreadCount() const
 	{
-		Worker* new_worker = new Worker(this);
-		new_worker->createThread();
-		m_workers.push_back(new_worker);
+		return m_thread_count;
 	}
 
-	void deleteWorkers()
+	// Worker i runs on the (first_cpu + i)th CPU of the topology pinning order
+	bool pinWorkers(uint32_t first_cpu = 0)
 	{
-		for (Worker* worker : m_workers) {
-			delete worker;
+		const std::vector<uint32_t> cpus = Topology::get().getPinningOrder();
+		bool success = true;
+		for (uint32_t i(0); i < m_thread_count; ++i) {
+			success &= pinThread(m_threads[i], cpus[(first_cpu + i) % cpus.size()]);
 		}
+		m_pinned = success;
+		return success;
 	}
 
-	void notifyWorkerReady(Worker* worker)
+	bool isPinned() const
 	{
-		std::lock_guard<std::mutex> lg(m_mutex);
-		++m_ready_count;
-		m_available_workers.push_back(worker);
+		return m_pinned;
 	}
 
-	friend Worker;
-};
+	void waitDone(uint32_t epoch)
+	{
+		// The waiting thread takes its share of the group, bound groups are left to the workers
+		if (epoch == m_epoch.load()) {
+			runGroup(epoch, false);
+		}
+		uint32_t done = m_done.load();
+		if (int32_t(done - epoch) >= 0) {
+			return;
+		}
+		const TraceScope trace("wait", epoch, m_index);
+		while (int32_t(done - epoch) < 0) {
+			m_done.waitWhileEqual(done, spin_count);
+			done = m_done.load();
+		}
+	}
 
-Worker::Worker(Swarm* swarm)
-	: m_swarm(swarm)
-	, m_group(nullptr)
-	, m_id(0)
-	, m_group_size(0)
-	, m_running(true)
-	, m_ready_mutex()
-	, m_done_mutex()
-{
-}
+private:
+	struct TaskQueue
+	{
+		std::mutex mutex;
+		std::deque<TaskPtr> tasks;
+	};
 
-void Worker::createThread()
-{
-	lockReady();
-	m_thread = std::thread(&Worker::run, this);
-}
+	const uint32_t m_thread_count;
+	std::vector<std::thread> m_threads;
+
+	InlineJob m_job;
+	// Only trusted once a claim with the right epoch succeeded
+	std::atomic<uint32_t> m_group_size;
+	// Epoch of the last dispatched group and of the last finished one
+	alignas(64) WaitWord m_epoch;
+	alignas(64) WaitWord m_done;
+	// Epoch in the high half, next id of the group in the low half with the bound flag on top
+	alignas(64) std::atomic<uint64_t> m_claim;
+	static constexpr uint64_t bound_flag = uint64_t(1) << 31;
+	alignas(64) std::atomic<uint32_t> m_remaining;
+
+	std::vector<std::unique_ptr<TaskQueue>> m_queues;
+	TaskQueue m_shared_queue;
+	std::atomic<uint32_t> m_pending_tasks;
+
+	// Incremented for every new group or task, idle workers sleep on it
+	alignas(64) WaitWord m_signal;
+	std::atomic<bool> m_running;
+	bool m_pinned;
+	// Identifies the swarm in traces
+	const uint32_t m_index;
+	static inline std::atomic<uint32_t> s_count{0};
+
+	// Worker of which swarm the current thread is, if any
+	static inline thread_local Swarm*   t_swarm = nullptr;
+	static inline thread_local uint32_t t_worker = 0;
+
+	void signal()
+	{
+		m_signal.increment();
+		m_signal.wakeAll();
+	}
 
-void Worker::run()
-{
-	while (true) {
-		waitReady();
+	void run(uint32_t id)
+	{
+		t_swarm = this;
+		t_worker = id;
+		if (Tracer::get().isEnabled()) {
+			Tracer::get().setThreadName("swarm " + std::to_string(m_index) + " worker " + std::to_string(id));
+		}
+		uint32_t handled_epoch = 0;
+		while (true) {
+			const uint32_t signal_value = m_signal.load();
+			if (!m_running) {
+				break;
+			}
+
+			const uint32_t epoch = m_epoch.load();
+			if (epoch != handled_epoch) {
+				handled_epoch = epoch;
+				runGroup(epoch, true);
+			}
+			else if (!runOneTask()) {
+				m_signal.waitWhileEqual(signal_value, spin_count);
+			}
+		}
+	}
+
+	template<typename F>
+	WorkGroup dispatch(F&& job, uint32_t size, bool bound)
+	{
+		// The previous group has to be done before its job is replaced
+		waitDone(m_epoch.load());
+
+		m_job.set(std::forward<F>(job));
+		m_group_size.store(size, std::memory_order_relaxed);
+		m_remaining.store(size, std::memory_order_relaxed);
+		// Only the dispatching thread changes the epoch
+		const uint32_t epoch = m_epoch.load() + 1;
+		// The claim goes first: a worker seeing the new epoch must also see its claim, or it would
+		// consider the group handled without running its part
+		m_claim.store((uint64_t(epoch) << 32) | (bound ? bound_flag : 0), std::memory_order_release);
+		m_epoch.store(epoch);
+		signal();
+		return WorkGroup(this, epoch);
+	}
 
-		if (!m_running) {
-			break;
+	void finishId(uint32_t epoch)
+	{
+		if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			m_done.store(epoch);
+			m_done.wakeAll();
 		}
+	}
 
-		m_job(m_id, m_group_size);
+	// Claims and runs ids of the group until there are none left
+	void runGroup(uint32_t epoch, bool worker_loop)
+	{
+		uint64_t claim = m_claim.load(std::memory_order_acquire);
+		if (uint32_t(claim >> 32) == epoch && (claim & bound_flag)) {
+			// The worker loop sees each epoch once, hence runs a bound job once
+			if (worker_loop) {
+				const TraceScope trace("job", epoch, m_index);
+				m_job(t_worker, m_thread_count);
+				finishId(epoch);
+			}
+			return;
+		}
+		while (true) {
+			if (uint32_t(claim >> 32) != epoch) {
+				return;
+			}
+			// A size read after the next dispatch makes the exchange fail since the epoch changed
+			const uint32_t size = m_group_size.load(std::memory_order_relaxed);
+			if (uint32_t(claim) >= size) {
+				return;
+			}
+			if (!m_claim.compare_exchange_weak(claim, claim + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+				continue;
+			}
+
+			{
+				const TraceScope trace("job", epoch, m_index);
+				m_job(uint32_t(claim), size);
+			}
+			finishId(epoch);
+			claim = m_claim.load(std::memory_order_acquire);
+		}
+	}
 
-		waitDone();
+	void addContinuation(Task& dependency, const TaskPtr& task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(dependency.m_mutex);
+			if (!dependency.m_finished) {
+				dependency.m_continuations.push_back(task);
+				return;
+			}
+		}
+		release(task);
 	}
-}
 
-void Worker::lockReady()
-{
-	m_ready_mutex.lock();
-}
+	void release(const TaskPtr& task)
+	{
+		if (task->m_dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			schedule(task);
+		}
+	}
 
-void Worker::unlockReady()
-{
-	m_ready_mutex.unlock();
-}
+	void schedule(const TaskPtr& task)
+	{
+		TaskQueue& queue = (t_swarm == this) ? *m_queues[t_worker] : m_shared_queue;
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back(task);
+		}
+		signal();
+	}
 
-void Worker::lockDone()
-{
-	m_done_mutex.lock();
-}
+	TaskPtr findTask()
+	{
+		TaskPtr task;
+		if (t_swarm == this && pop(*m_queues[t_worker], task, true)) {
+			return task;
+		}
+		if (pop(m_shared_queue, task, false)) {
+			return task;
+		}
+		// Steal from the others, starting after our own queue
+		const uint32_t first = (t_swarm == this) ? t_worker + 1 : 0;
+		for (uint32_t i(0); i < m_thread_count; ++i) {
+			if (pop(*m_queues[(first + i) % m_thread_count], task, false)) {
+				return task;
+			}
+		}
+		return nullptr;
+	}
 
-void Worker::unlockDone()
-{
-	m_done_mutex.unlock();
-}
+	static bool pop(TaskQueue& queue, TaskPtr& task, bool from_back)
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) {
+			return false;
+		}
+		if (from_back) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		return true;
+	}
 
-void Worker::setJob(uint32_t id, ExecutionGroup* group)
-{
-	m_id = id;
-	m_job = group->m_job;
-	m_group_size = group->m_group_size;
-	m_group = group;
-}
+	bool runOneTask()
+	{
+		TaskPtr task = findTask();
+		if (!task) {
+			return false;
+		}
 
-void Worker::stop()
-{
-	m_running = false;
-}
+		{
+			const TraceScope trace("task");
+			task->execute();
+		}
+		std::vector<TaskPtr> continuations;
+		{
+			std::lock_guard<std::mutex> lock(task->m_mutex);
+			task->m_finished = true;
+			continuations.swap(task->m_continuations);
+		}
+		task->m_done.store(1);
+		task->m_done.wakeAll();
+		for (const TaskPtr& continuation : continuations) {
+			release(continuation);
+		}
+		m_pending_tasks.fetch_sub(1, std::memory_order_acq_rel);
+		return true;
+	}
+};
 
-void Worker::join()
+void WorkGroup::waitExecutionDone()
 {
-	m_thread.join();
+	if (m_swarm) {
+		m_swarm->waitDone(m_epoch);
+	}
 }
 
-void Worker::waitReady()
+template<typename R>
+void Future<R>::wait() const
 {
-	m_swarm->notifyWorkerReady(this);
-	lockReady();
-	unlockReady();
+	m_swarm->waitFor(*m_task);
 }
 
-void Worker::waitDone()
+template<typename R>
+template<typename F>
+auto Future<R>::then(F&& function) const
 {
-	m_group->notifyWorkerDone();
-	lockDone();
-	unlockDone();
+	std::shared_ptr<ResultTask<R>> task = m_task;
+	return m_swarm->after({ m_task }, [task, function]() mutable {
+		// A failure of the dependency is passed on to the continuation
+		if (task->m_error) {
+			std::rethrow_exception(task->m_error);
+		}
+		if constexpr (std::is_void<R>::value) {
+			return function();
+		}
+		else {
+			return function(*task->m_value);
+		}
+	});
 }
 
 }
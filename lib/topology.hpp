@@ -0,0 +1,206 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <tuple>
+
+#if defined(__linux__)
+	#include <sched.h>
+	#include <pthread.h>
+#endif
+
+namespace swrm
+{
+
+/*
+	Logical CPUs the process is allowed to run on, with the physical core, package, NUMA node
+	and L3 cache each one belongs to. Read from sysfs on Linux, elsewhere every hardware
+	thread is considered a core of its own.
+*/
+struct Topology
+{
+	struct Cpu
+	{
+		uint32_t id;
+		int32_t core;
+		int32_t package;
+		int32_t node;
+		int32_t l3;
+	};
+
+	std::vector<Cpu> cpus;
+
+	// Detected once per process
+	static const Topology& get()
+	{
+		static const Topology topology = detect();
+		return topology;
+	}
+
+	static Topology detect()
+	{
+		Topology result;
+#if defined(__linux__)
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (!sched_getaffinity(0, sizeof(allowed), &allowed)) {
+			std::vector<int32_t> nodes(CPU_SETSIZE, 0);
+			// Node directories can have holes, missing ones are skipped
+			for (uint32_t n(0); n < 256; ++n) {
+				for (const uint32_t cpu : parseList(readFile("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist"))) {
+					if (cpu < CPU_SETSIZE) {
+						nodes[cpu] = int32_t(n);
+					}
+				}
+			}
+			for (uint32_t id(0); id < CPU_SETSIZE; ++id) {
+				if (!CPU_ISSET(id, &allowed)) {
+					continue;
+				}
+				const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(id);
+				Cpu cpu;
+				cpu.id = id;
+				cpu.core = readInt(path + "/topology/core_id", int32_t(id));
+				cpu.package = readInt(path + "/topology/physical_package_id", 0);
+				cpu.node = nodes[id];
+				cpu.l3 = readInt(path + "/cache/index3/id", cpu.package);
+				result.cpus.push_back(cpu);
+			}
+		}
+#endif
+		if (result.cpus.empty()) {
+			const uint32_t count = std::max(1u, std::thread::hardware_concurrency());
+			for (uint32_t id(0); id < count; ++id) {
+				result.cpus.push_back({ id, int32_t(id), 0, 0, 0 });
+			}
+		}
+		return result;
+	}
+
+	uint32_t getCoresCount() const
+	{
+		std::vector<std::pair<int32_t, int32_t>> cores;
+		for (const Cpu& cpu : cpus) {
+			cores.emplace_back(cpu.package, cpu.core);
+		}
+		return countDistinct(cores);
+	}
+
+	uint32_t getNodesCount() const
+	{
+		std::vector<int32_t> nodes;
+		for (const Cpu& cpu : cpus) {
+			nodes.push_back(cpu.node);
+		}
+		return countDistinct(nodes);
+	}
+
+	uint32_t getL3Count() const
+	{
+		std::vector<std::pair<int32_t, int32_t>> caches;
+		for (const Cpu& cpu : cpus) {
+			caches.emplace_back(cpu.package, cpu.l3);
+		}
+		return countDistinct(caches);
+	}
+
+	// Simulation steps are compute bound, hyperthreads bring little
+	uint32_t getDefaultThreadCount() const
+	{
+		return std::max(1u, getCoresCount());
+	}
+
+	/*
+		CPUs in the order workers are pinned to them: one per physical core, node after node
+		and cache after cache so that consecutive workers share as much as possible,
+		then the hyperthread siblings.
+	*/
+	std::vector<uint32_t> getPinningOrder() const
+	{
+		std::vector<Cpu> sorted = cpus;
+		std::stable_sort(sorted.begin(), sorted.end(), [](const Cpu& a, const Cpu& b) {
+			return std::tie(a.node, a.package, a.l3, a.core) < std::tie(b.node, b.package, b.l3, b.core);
+		});
+		std::vector<uint32_t> result;
+		std::vector<uint32_t> siblings;
+		for (uint64_t i(0); i < sorted.size(); ++i) {
+			const bool same_core = i && sorted[i].package == sorted[i - 1].package && sorted[i].core == sorted[i - 1].core;
+			(same_core ? siblings : result).push_back(sorted[i].id);
+		}
+		result.insert(result.end(), siblings.begin(), siblings.end());
+		return result;
+	}
+
+	std::string describe() const
+	{
+		std::stringstream sstr;
+		sstr << cpus.size() << " cpus, " << getCoresCount() << " cores, " << getL3Count() << " L3, " << getNodesCount() << " NUMA nodes";
+		return sstr.str();
+	}
+
+	// Lists like "0-3,8,10-11"
+	static std::vector<uint32_t> parseList(const std::string& list)
+	{
+		std::vector<uint32_t> result;
+		std::stringstream sstr(list);
+		std::string range;
+		while (std::getline(sstr, range, ',')) {
+			uint32_t first, last;
+			if (std::sscanf(range.c_str(), "%u-%u", &first, &last) == 2) {
+				for (uint32_t i(first); i <= last; ++i) {
+					result.push_back(i);
+				}
+			}
+			else if (std::sscanf(range.c_str(), "%u", &first) == 1) {
+				result.push_back(first);
+			}
+		}
+		return result;
+	}
+
+private:
+	static std::string readFile(const std::string& path)
+	{
+		std::ifstream file(path);
+		std::string result;
+		std::getline(file, result);
+		return result;
+	}
+
+	static int32_t readInt(const std::string& path, int32_t fallback)
+	{
+		std::ifstream file(path);
+		int32_t result;
+		return (file >> result) ? result : fallback;
+	}
+
+	template<typename T>
+	static uint32_t countDistinct(std::vector<T> values)
+	{
+		std::sort(values.begin(), values.end());
+		return uint32_t(std::unique(values.begin(), values.end()) - values.begin());
+	}
+};
+
+// Restricts a thread to a single CPU, false where it isn't supported
+inline bool pinThread(std::thread& thread, uint32_t cpu)
+{
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return !pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+	(void)thread;
+	(void)cpu;
+	return false;
+#endif
+}
+
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <fstream>
+#include <algorithm>
+#include <iostream>
+
+namespace swrm
+{
+
+/*
+	Records timed events in per thread rings and writes them as Chrome trace events (Perfetto,
+	chrome://tracing). Each ring has a single writer and keeps its last capacity events, so tracing
+	can stay on for long runs. Disabled, an event costs a relaxed load.
+	The trace has to be written once the traced threads are idle.
+*/
+class Tracer
+{
+public:
+	struct Event
+	{
+		const char* name;
+		uint64_t start_ns;
+		uint64_t duration_ns;
+		// Fork-join group epoch for jobs and waits, epochs are per swarm
+		uint32_t group;
+		uint32_t swarm;
+	};
+
+	struct ThreadBuffer
+	{
+		std::string name;
+		std::vector<Event> events;
+		std::atomic<uint64_t> written{0};
+	};
+
+	static Tracer& get()
+	{
+		static Tracer tracer;
+		return tracer;
+	}
+
+	// Events already recorded by threads started before are kept, the capacity applies to new rings
+	void enable(uint64_t capacity_per_thread = 1 << 16)
+	{
+		m_capacity = std::max<uint64_t>(1, capacity_per_thread);
+		m_enabled.store(true, std::memory_order_release);
+	}
+
+	bool isEnabled() const
+	{
+		return m_enabled.load(std::memory_order_relaxed);
+	}
+
+	uint64_t now() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_origin).count();
+	}
+
+	void record(const char* name, uint64_t start_ns, uint64_t end_ns, uint32_t group = 0, uint32_t swarm = 0)
+	{
+		ThreadBuffer& buffer = getBuffer();
+		const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+		buffer.events[index % buffer.events.size()] = { name, start_ns, end_ns - start_ns, group, swarm };
+		buffer.written.store(index + 1, std::memory_order_release);
+	}
+
+	void setThreadName(const std::string& name)
+	{
+		getBuffer().name = name;
+	}
+
+	// Workers of a swarm that ran no job of a group still count as idle in its imbalance
+	void setSwarmThreadCount(uint32_t swarm, uint32_t thread_count)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_swarm_threads[swarm] = thread_count;
+	}
+
+	/*
+		Every event as a complete ("X") event, one track per thread. For each fork-join group,
+		identified by its swarm and epoch, a counter gives the imbalance of its workers: busiest
+		worker time over mean worker time, idle workers included.
+	*/
+	void write(const std::string& filename)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::ofstream file(filename);
+		file << "{\"traceEvents\": [\n";
+		bool first = true;
+		const auto separator = [&]() -> std::ofstream& {
+			file << (first ? "" : ",\n");
+			first = false;
+			return file;
+		};
+
+		// Busy time of each thread in each group, and the group start
+		using GroupKey = std::pair<uint32_t, uint32_t>;
+		std::map<GroupKey, std::map<uint64_t, uint64_t>> groups_busy;
+		std::map<GroupKey, uint64_t> groups_start;
+		uint64_t wait_ns = 0;
+		for (uint64_t tid(0); tid < m_buffers.size(); ++tid) {
+			const ThreadBuffer& buffer = *m_buffers[tid];
+			separator() << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << tid << ", \"args\": {\"name\": \"" << buffer.name << "\"}}";
+			const uint64_t written = buffer.written.load(std::memory_order_acquire);
+			const uint64_t size = buffer.events.size();
+			for (uint64_t i(written > size ? written - size : 0); i < written; ++i) {
+				const Event& event = buffer.events[i % size];
+				separator() << "{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << tid
+					<< ", \"ts\": " << double(event.start_ns) * 1e-3 << ", \"dur\": " << double(event.duration_ns) * 1e-3;
+				if (event.group) {
+					file << ", \"args\": {\"swarm\": " << event.swarm << ", \"group\": " << event.group << "}";
+				}
+				file << "}";
+
+				if (event.group && std::string(event.name) == "job") {
+					const GroupKey key(event.swarm, event.group);
+					groups_busy[key][tid] += event.duration_ns;
+					const auto it = groups_start.find(key);
+					groups_start[key] = (it == groups_start.end()) ? event.start_ns : std::min(it->second, event.start_ns);
+				}
+				else if (std::string(event.name) == "wait") {
+					wait_ns += event.duration_ns;
+				}
+			}
+		}
+
+		double imbalance_sum = 0.0;
+		for (const auto& group : groups_busy) {
+			uint64_t total = 0;
+			uint64_t busiest = 0;
+			for (const auto& thread : group.second) {
+				total += thread.second;
+				busiest = std::max(busiest, thread.second);
+			}
+			// The dispatching thread may have taken jobs on top of the workers
+			const auto threads = m_swarm_threads.find(group.first.first);
+			const uint64_t participants = std::max<uint64_t>(group.second.size(), threads == m_swarm_threads.end() ? 0 : threads->second);
+			const double mean = double(total) / double(participants);
+			const double imbalance = mean > 0.0 ? double(busiest) / mean : 1.0;
+			imbalance_sum += imbalance;
+			separator() << "{\"name\": \"imbalance\", \"ph\": \"C\", \"pid\": 0, \"ts\": " << double(groups_start[group.first]) * 1e-3
+				<< ", \"args\": {\"busiest_over_mean\": " << imbalance << "}}";
+		}
+		file << "\n]}" << std::endl;
+
+		std::cout << "Trace written in " << filename << ", " << groups_busy.size() << " groups, mean imbalance "
+			<< (groups_busy.empty() ? 1.0 : imbalance_sum / double(groups_busy.size())) << ", " << double(wait_ns) * 1e-6 << " ms waiting for groups" << std::endl;
+	}
+
+private:
+	std::atomic<bool> m_enabled{false};
+	uint64_t m_capacity = 1 << 16;
+	std::chrono::steady_clock::time_point m_origin = std::chrono::steady_clock::now();
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+	std::map<uint32_t, uint32_t> m_swarm_threads;
+
+	ThreadBuffer& getBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (!buffer) {
+			// Rings outlive their thread so that its events can still be written
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_buffers.push_back(std::make_unique<ThreadBuffer>());
+			buffer = m_buffers.back().get();
+			buffer->name = "thread " + std::to_string(m_buffers.size() - 1);
+			buffer->events.resize(m_capacity);
+		}
+		return *buffer;
+	}
+};
+
+// Records its lifetime as an event when tracing is enabled
+class TraceScope
+{
+public:
+	TraceScope(const char* name, uint32_t group = 0, uint32_t swarm = 0)
+		: m_name(Tracer::get().isEnabled() ? name : nullptr)
+		, m_group(group)
+		, m_swarm(swarm)
+		, m_start(m_name ? Tracer::get().now() : 0)
+	{}
+
+	~TraceScope()
+	{
+		if (m_name) {
+			Tracer& tracer = Tracer::get();
+			tracer.record(m_name, m_start, tracer.now(), m_group, m_swarm);
+		}
+	}
+
+private:
+	const char* m_name;
+	uint32_t m_group;
+	uint32_t m_swarm;
+	uint64_t m_start;
+};
+
+}
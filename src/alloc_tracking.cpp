@@ -0,0 +1,89 @@
+#include "alloc_tracker.hpp"
+
+#if defined(AUTODRONE_ALLOC_TRACKING)
+
+#include <new>
+#include <cstdlib>
+
+
+/*
+	Counting replacements of the global allocation functions, every other form forwards to these.
+*/
+namespace
+{
+
+void* allocate(std::size_t size)
+{
+	alloc::onAllocation(size);
+	while (true) {
+		if (void* p = std::malloc(size ? size : 1)) {
+			return p;
+		}
+		std::new_handler handler = std::get_new_handler();
+		if (!handler) {
+			throw std::bad_alloc();
+		}
+		handler();
+	}
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t alignment)
+{
+	alloc::onAllocation(size);
+	const std::size_t align = std::max(std::size_t(alignment), sizeof(void*));
+	void* p = nullptr;
+	if (posix_memalign(&p, align, size ? size : 1)) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void release(void* p)
+{
+	if (p) {
+		alloc::onFree();
+		std::free(p);
+	}
+}
+
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try { return allocate(size); } catch (...) { return nullptr; }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	try { return allocate(size); } catch (...) { return nullptr; }
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try { return allocateAligned(size, alignment); } catch (...) { return nullptr; }
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try { return allocateAligned(size, alignment); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, std::size_t) noexcept { release(p); }
+void operator delete[](void* p, std::size_t) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+
+#endif
@@ -10,14 +10,288 @@
 #include "stadium.hpp"
 #include "resource_manager.hpp"
 #include "interface_controls.hpp"
+#include "island_runner.hpp"
+#include "options.hpp"
+#include "distributed.hpp"
+#include "pruning_check.hpp"
+#include "sparse_check.hpp"
+#include "quantization_check.hpp"
+#include "distillation.hpp"
+#include "cma_es.hpp"
+#include "evolution_strategy.hpp"
+#include "autotuner.hpp"
+#include "macro_benchmark.hpp"
 
 
-int main()
+// Hidden sizes separated by x, architectures by commas
+std::vector<std::vector<uint64_t>> parseArchitectures(const std::string& description)
+{
+	std::vector<std::vector<uint64_t>> result;
+	const std::vector<uint64_t>& base = getArchitecture();
+	std::stringstream architectures(description);
+	std::string hidden_sizes;
+	while (std::getline(architectures, hidden_sizes, ',')) {
+		std::vector<uint64_t> layers = { base.front() };
+		std::stringstream sizes(hidden_sizes);
+		std::string size;
+		while (std::getline(sizes, size, 'x')) {
+			layers.push_back(std::stoul(size));
+		}
+		layers.push_back(base.back());
+		result.push_back(layers);
+	}
+	return result;
+}
+
+
+// first_cpu is where the stadium's workers start in the pinning order, islands don't share cores
+// island offsets the optimizers seed so that islands don't sample the same candidates
+void configureStadium(Stadium& stadium, const Options& options, float dt, uint32_t first_cpu = 0, uint32_t island = 0)
+{
+	stadium.pruning = options.pruning;
+	stadium.pruner.slack = options.pruning_slack;
+	stadium.prescreening = options.prescreening;
+	stadium.prescreening_dt = dt;
+	stadium.setScenariosCount(options.scenarios);
+	stadium.fixed_scenarios = options.fixed_scenarios;
+	stadium.scenarios_seed = options.seed;
+	stadium.fitness_caching = options.fitness_cache;
+	stadium.aggregator.quantile = options.quantile;
+	stadium.steady_state = options.steady_state;
+	// Both work per drone, Stadium::update skips them with several scenarios
+	if (stadium.scenarios_count > 1 && (options.pruning || options.steady_state)) {
+		std::cout << "Pruning and steady state need a single scenario, ignored" << std::endl;
+		stadium.pruning = false;
+		stadium.steady_state = false;
+	}
+	// Steady state children are bred by its own pool, not by the optimizer
+	if (options.optimizer != "ga" && stadium.steady_state) {
+		std::cout << "Steady state needs genetic selection, ignored" << std::endl;
+		stadium.steady_state = false;
+	}
+	// The cutoff follows the genetic survivors, optimizers rank the whole population
+	if (options.optimizer != "ga" && stadium.pruning) {
+		std::cout << "Pruning needs generational genetic selection, ignored" << std::endl;
+		stadium.pruning = false;
+	}
+	if (options.aggregation == "min") {
+		stadium.aggregator.mode = FitnessAggregation::Min;
+	}
+	else if (options.aggregation == "quantile") {
+		stadium.aggregator.mode = FitnessAggregation::Quantile;
+	}
+
+	// Buckets were only kept for generational genetic selection
+	if (getBucketsCount() > 1) {
+		stadium.assignBuckets();
+	}
+
+	// Genomes may not have the base architecture (mirrored controller)
+	const uint64_t parameters_count = stadium.selector.getCurrentPopulation().front().dna.getGenesCount();
+	const uint32_t optimizer_seed = options.seed + island;
+	if (options.optimizer == "cmaes") {
+		stadium.selector.optimizer = std::make_unique<CmaEsOptimizer>(parameters_count, stadium.population_size, 0.5, optimizer_seed);
+	}
+	else if (options.optimizer == "es") {
+		// One table for all islands, 64MB of noise
+		static const auto noise_table = std::make_shared<const NoiseTable>(1 << 24, options.seed);
+		stadium.selector.optimizer = std::make_unique<EsOptimizer>(parameters_count, noise_table, stadium.swarm, optimizer_seed);
+	}
+
+	// Last, once every drone buffer is allocated
+	if (options.pin && !stadium.pinWorkers(first_cpu)) {
+		std::cout << "Cannot pin worker threads, left to the scheduler" << std::endl;
+	}
+}
+
+
+int main(int argc, char** argv)
 {
 	NumberGenerator<>::initialize();
+	const Options options(argc, argv);
+	// The trace is written when main returns, after every swarm has stopped
+	struct TraceWriter
+	{
+		std::string filename;
+		~TraceWriter()
+		{
+			if (!filename.empty()) {
+				swrm::Tracer::get().write(filename);
+			}
+		}
+	} trace_writer{ options.trace };
+	if (!options.trace.empty()) {
+		swrm::Tracer::get().enable(options.trace_capacity);
+		swrm::Tracer::get().setThreadName("main");
+	}
+	if (options.perf) {
+		perf::Monitor::get().enable();
+	}
+	if (options.macro_benchmark) {
+		// Every genome and breeding decision has to come from the seed
+		NumberGenerator<>::initialize(options.seed);
+	}
+	// Before any genome is created
+	if (options.genes == "fp16") {
+		gene_encoding = GeneEncoding::Float16;
+	}
+	else if (options.genes == "bf16") {
+		gene_encoding = GeneEncoding::BFloat16;
+	}
+	mirrored_controller = options.mirrored;
+	if (!options.buckets.empty()) {
+		// Before any drone is built, optimizers and steady state breeding need a single genome length
+		if (options.optimizer != "ga" || options.steady_state) {
+			std::cout << "Architecture buckets need generational genetic selection, ignored" << std::endl;
+		}
+		else {
+			architecture_buckets = parseArchitectures(options.buckets);
+		}
+	}
 
 	const uint32_t win_width = 1920;
 	const uint32_t win_height = 1080;
+	const float scale = 2.0f;
+	const float dt = 0.008f;
+	const uint32_t pop_size = 800;
+	if (!options.profile_csv.empty() && !profiler::enabled) {
+		std::cout << "Built without AUTODRONE_PROFILING, phase timings will be zero" << std::endl;
+	}
+	if ((options.alloc_report || options.alloc_enforce) && !alloc::enabled) {
+		std::cout << "Built without AUTODRONE_ALLOC_TRACKING, allocations are not tracked" << std::endl;
+	}
+	alloc::setEnforced(options.alloc_enforce);
+	std::cout << "Topology: " << swrm::Topology::get().describe() << std::endl;
+
+#if defined(__unix__) || defined(__APPLE__)
+	if (options.workers) {
+		// Headless coordinator, workers are forked before anything else starts threads
+		DistributedCoordinator coordinator(options.workers, pop_size, scale * sf::Vector2f(win_width, win_height), dt, options.seed);
+		coordinator.run(options.generations);
+		return 0;
+	}
+#endif
+
+	// Setting found by a previous --tune run on this host, explicit --threads wins
+	Autotuner::Setting tuning;
+	Autotuner::getSetting(pop_size, scale * sf::Vector2f(win_width, win_height), dt, options.tune, tuning);
+	if (options.tune) {
+		return 0;
+	}
+	if (options.threads) {
+		tuning.threads = options.threads;
+	}
+
+	if (options.macro_benchmark) {
+		Stadium stadium(pop_size, scale * sf::Vector2f(win_width, win_height), tuning.threads);
+		stadium.update_grain = tuning.grain;
+		configureStadium(stadium, options, dt);
+		stadium.setTargetsSeed(options.seed);
+		const uint32_t generations = options.generations ? options.generations : 30;
+		const std::string golden = options.golden.empty() ? "../golden_fitness_" + std::to_string(options.seed) + ".txt" : options.golden;
+		const bool matches = MacroBenchmark::run(stadium, dt, generations, golden, options.golden_tolerance, options.profile_csv);
+		if (options.perf) {
+			perf::Monitor::get().report();
+		}
+		if (options.alloc_report) {
+			alloc::report();
+		}
+		return matches ? 0 : 1;
+	}
+
+	if (options.pruning_check) {
+		if (options.optimizer != "ga") {
+			std::cout << "Pruning check needs generational genetic selection" << std::endl;
+			return 1;
+		}
+		Stadium stadium(pop_size, scale * sf::Vector2f(win_width, win_height));
+		stadium.pruner.slack = options.pruning_slack;
+		// Evolve a bit first so that fitness spreads enough to prune something
+		for (uint32_t i(0); i < options.generations; ++i) {
+			stadium.evaluatePopulation(dt);
+			stadium.selector.nextGeneration();
+		}
+		return PruningCheck::run(stadium, dt, options.seed) ? 0 : 1;
+	}
+
+	if (options.sparse_check) {
+		Stadium stadium(pop_size, scale * sf::Vector2f(win_width, win_height));
+		for (uint32_t i(0); i < options.generations; ++i) {
+			stadium.evaluatePopulation(dt);
+			stadium.selector.nextGeneration();
+		}
+		SparseCheck::run(stadium, dt, options.seed, options.sparse_threshold);
+		return 0;
+	}
+
+	if (!options.distill.empty()) {
+		if (options.mirrored || !options.buckets.empty()) {
+			std::cout << "Distillation needs a teacher with the default controller" << std::endl;
+			return 1;
+		}
+		Stadium stadium(pop_size, scale * sf::Vector2f(win_width, win_height));
+		for (uint32_t i(0); i < options.generations; ++i) {
+			stadium.selector.nextGeneration();
+			stadium.evaluatePopulation(dt);
+		}
+		const DNA teacher = QuantizationCheck::getChampions(stadium, 1).front();
+		return Distillation::run(teacher, getArchitecture(), parseArchitectures(options.distill).front(), stadium.area_size, dt, options.seed, options.distill_ratio) ? 0 : 1;
+	}
+
+	if (options.quantization_check) {
+		Stadium stadium(pop_size, scale * sf::Vector2f(win_width, win_height));
+		for (uint32_t i(0); i < options.generations; ++i) {
+			stadium.selector.nextGeneration();
+			stadium.evaluatePopulation(dt);
+		}
+		const uint32_t champions_count = 16;
+		QuantizationCheck::run(QuantizationCheck::getChampions(stadium, champions_count), stadium.area_size, dt, options.seed, options.scenarios);
+		return 0;
+	}
+
+	if (options.islands) {
+		// Headless island mode, the viewer is not started
+		IslandRunner runner(options.islands, pop_size, scale * sf::Vector2f(win_width, win_height), options.seed, options.threads);
+		uint32_t first_cpu = 0;
+		for (uint32_t i(0); i < runner.islands.size(); ++i) {
+			IslandRunner::Island& island = *runner.islands[i];
+			configureStadium(island.stadium, options, dt, first_cpu, i);
+			island.stadium.update_grain = tuning.grain;
+			first_cpu += island.stadium.swarm.getThreadCount();
+		}
+		runner.target_fitness = options.target_fitness;
+		// Islands only exchange genomes between generational genetic populations
+		if (options.islands > 1 && (options.optimizer != "ga" || options.steady_state)) {
+			std::cout << "Migration needs generational genetic selection, ignored" << std::endl;
+		}
+		std::unique_ptr<profiler::CsvExport> profile;
+		profiler::History profile_history;
+		if (!options.profile_csv.empty()) {
+			// Times are summed over the threads of every island, rows follow the first island
+			profile = std::make_unique<profiler::CsvExport>(options.profile_csv, "island_0_generation");
+		}
+		alloc::Totals last_allocations = alloc::getTotals();
+		runner.on_generation = [&](uint32_t generation) {
+			if (profile) {
+				profile->write(generation, profile_history.collect());
+			}
+			if (options.alloc_report && alloc::enabled) {
+				const alloc::Totals allocations = alloc::getTotals();
+				alloc::printGeneration(generation, last_allocations, allocations);
+				last_allocations = allocations;
+			}
+		};
+		runner.run(dt, options.generations);
+		std::cout << "Best fitness over islands: " << runner.getBestFitness() << std::endl;
+		if (options.perf) {
+			perf::Monitor::get().report();
+		}
+		if (options.alloc_report) {
+			alloc::report();
+		}
+		return 0;
+	}
+
 	sf::ContextSettings settings;
 	settings.antialiasingLevel = 4;
 	sf::RenderWindow window(sf::VideoMode(win_width, win_height), "AutoDrone", sf::Style::Default, settings);
@@ -33,10 +307,7 @@ int main()
 	// Define constants
 	const float target_radius = 8.0f;
 	const float GUI_MARGIN = 10.0f;
-	const float scale = 2.0f;
-	const float dt = 0.008f;
 	const float max_iteration_duration = 100.0f;
-	const uint32_t pop_size = 800;
 	const std::vector<sf::Color> colors({ sf::Color(36, 123, 160),
 									sf::Color(161, 88, 86),
 									sf::Color(249, 160, 97),
@@ -58,22 +329,36 @@ int main()
 	sf::Text best_score_text = BaseManager::CreateText("font", 32);
 	generation_text.setPosition(GUI_MARGIN * 2.0f, GUI_MARGIN);
 	best_score_text.setPosition(4.0f * GUI_MARGIN, 64);
+	// Phase timings, right of the fitness graph
+	sf::Text profile_text = BaseManager::CreateText("font", 16);
+	profile_text.setPosition(2.0f * GUI_MARGIN + 700, win_height - 120 - GUI_MARGIN);
+	profiler::History profile_history;
 
-	Stadium stadium(pop_size, scale * sf::Vector2f(win_width, win_height));
+	Stadium stadium(pop_size, scale * sf::Vector2f(win_width, win_height), tuning.threads);
+	stadium.update_grain = tuning.grain;
+	configureStadium(stadium, options, dt);
 	//stadium.loadDnaFromFile("../selector_output_18.bin");
 
 	sf::RenderStates state;
 	DroneRenderer drone_renderer;
 	state.transform.scale(1.0f / scale, 1.0f / scale);
 
+	uint32_t displayed_generation = stadium.selector.generation;
 	while (window.isOpen()) {
-		event_manager.processEvents();
+		{
+			PROFILE_SCOPE(Events);
+			event_manager.processEvents();
+		}
 		
 		// Check for new generation
 		if (stadium.isDone()) {
-			fitness_graph.next();
 			stadium.newIteration();
 		}
+		// Generations also advance without barrier in steady state mode
+		if (stadium.selector.generation != displayed_generation) {
+			fitness_graph.next();
+			displayed_generation = stadium.selector.generation;
+		}
 		std::vector<Drone>& population = stadium.selector.getCurrentPopulation();
 
 		stadium.update(dt, !controls.full_speed);
@@ -83,6 +368,9 @@ int main()
 		best_score_text.setString("Score " + toString(stadium.current_iteration.best_fitness));
 
 		// Render
+		PROFILE_SCOPE(Rendering);
+		ALLOC_PHASE(Rendering);
+		ALLOC_UNIT(Rendering);
 		window.clear();
 		window.draw(generation_text);
 		window.draw(best_score_text);
@@ -90,7 +378,7 @@ int main()
 		uint32_t current_drone_i = 0;
 		if (controls.draw_drones) {
 			if (controls.show_just_one) {
-				const Drone& d = stadium.selector.getCurrentPopulation()[stadium.current_iteration.best_unit];
+				const Drone& d = stadium.getDrone(stadium.current_iteration.best_unit);
 				drone_renderer.draw(d, window, state, colors[d.index%colors.size()], !controls.full_speed);
 			}
 			else {
@@ -106,7 +394,8 @@ int main()
 			sf::CircleShape target_c(target_radius);
 			target_c.setFillColor(sf::Color(255, 128, 0));
 			target_c.setOrigin(target_radius, target_radius);
-			target_c.setPosition(stadium.targets[stadium.objectives[stadium.current_iteration.best_unit].target_id]);
+			const uint32_t best_unit = stadium.current_iteration.best_unit;
+			target_c.setPosition(stadium.getTargets(best_unit)[stadium.objectives[best_unit].target_id]);
 			window.draw(target_c, state);
 		}
 
@@ -114,6 +403,17 @@ int main()
 			fitness_graph.render(window);
 		}
 
+		if (profiler::enabled) {
+			profile_history.collect();
+			const profiler::Sample average = profile_history.getAverage();
+			std::string profile_string;
+			for (uint32_t i(0); i < profiler::phases_count; ++i) {
+				profile_string += std::string(profiler::getName(i)) + " " + toString(average.milliseconds[i]) + " ms\n";
+			}
+			profile_text.setString(profile_string);
+			window.draw(profile_text);
+		}
+
 		window.display();
 	}
 